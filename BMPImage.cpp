@@ -1,63 +1,598 @@
-#include "BmpImage.h"
+#include "BMPImage.h"
+#include "utils/bufferpool.h"
+#include "utils/threadpool.h"
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
 
-bool BmpImage::load(const string& filename) {
-    ifstream file(filename, ios::binary);
-    if (!file) return false;
+#if defined(__unix__) || defined(__APPLE__)
+#define BMP_POSIX_IO 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+PixelBuffer::PixelBuffer(const PixelBuffer& other) {
+    allocate(other.length);
+    if (other.length > 0) memcpy(bytes, other.bytes, other.length);
+}
+
+PixelBuffer& PixelBuffer::operator=(const PixelBuffer& other) {
+    if (this != &other) {
+        PixelBuffer copy(other);
+        *this = move(copy);
+    }
+    return *this;
+}
+
+PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept {
+    *this = move(other);
+}
+
+PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        bytes = exchange(other.bytes, nullptr);
+        length = exchange(other.length, 0);
+        capacity = exchange(other.capacity, 0);
+        mapBase = exchange(other.mapBase, nullptr);
+        mapLength = exchange(other.mapLength, 0);
+        mapFile = exchange(other.mapFile, {});
+    }
+    return *this;
+}
+
+PixelBuffer::~PixelBuffer() {
+    release();
+}
+
+#ifdef BMP_POSIX_IO
+/**
+ * @brief Archivos (dispositivo, inodo) que tiene mapeados alguna imagen del proceso, con la cantidad
+ * de mapeos de cada uno. El mutex también ordena los mapeos con las aperturas de save.
+ */
+static mutex mappedFilesMutex;
+static map<pair<uint64_t, uint64_t>, int> mappedFiles;
+#endif
+
+void PixelBuffer::release() {
+#ifdef BMP_POSIX_IO
+    if (mapBase) {
+        munmap(mapBase, mapLength);
+        lock_guard<mutex> lock(mappedFilesMutex);
+        if (--mappedFiles[mapFile] == 0) mappedFiles.erase(mapFile);
+    } else {
+        recycleBuffer(bytes, capacity);
+    }
+#else
+    recycleBuffer(bytes, capacity);
+#endif
+    bytes = nullptr;
+    length = 0;
+    capacity = 0;
+    mapBase = nullptr;
+    mapLength = 0;
+    mapFile = {};
+}
 
+void PixelBuffer::allocate(size_t size) {
+    // El bloque propio se reutiliza si alcanza (por ejemplo, al recrear una imagen auxiliar)
+    if (!mapBase && size <= capacity) {
+        length = size;
+        return;
+    }
+    release();
+    bytes = size > 0 ? acquireBuffer(size, capacity) : nullptr;
+    length = size;
+}
+
+bool PixelBuffer::map(const string& filename, size_t offset, size_t size) {
+#ifdef BMP_POSIX_IO
+    if (size == 0) return false;
+    // Con el mutex tomado, save no puede truncar el archivo entre que se mide y se registra el mapeo
+    unique_lock<mutex> lock(mappedFilesMutex);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < offset + size) {
+        close(fd);
+        return false;
+    }
+
+    // mmap necesita que el offset sea múltiplo del tamaño de página
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / page * page;
+    size_t delta = offset - start;
+    void* base = mmap(nullptr, size + delta, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(start));
+    close(fd);
+    if (base == MAP_FAILED) return false;
+    pair<uint64_t, uint64_t> file = { info.st_dev, info.st_ino };
+    ++mappedFiles[file];
+    lock.unlock();
+
+    release();
+    mapFile = file;
+    mapBase = base;
+    mapLength = size + delta;
+    bytes = static_cast<uint8_t*>(base) + delta;
+    length = size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Tamaño máximo de los bytes extra del header (headers V4/V5, máscaras, perfiles de color).
+ */
+static const uint32_t MAX_EXTRA_HEADER = 1 << 20;
+
+static const uint32_t BMP_RGB = 0;
+static const uint32_t BMP_BITFIELDS = 3;
+
+/**
+ * @brief Indica si las máscaras de un archivo de 32 bits con BI_BITFIELDS son las de BGRA.
+ * @details Las máscaras de rojo, verde y azul van justo después del info header de 40 bytes, tanto
+ * en los headers V3 como en los V4/V5, que además agregan la de alfa.
+ */
+static bool hasBgraMasks(const BmpInfoHeader& infoHeader, const vector<uint8_t>& extraHeader) {
+    if (extraHeader.size() < 12) return false;
+    uint32_t masks[4] = { 0, 0, 0, 0 };
+    memcpy(masks, extraHeader.data(), min<size_t>(extraHeader.size(), sizeof(masks)));
+    bool alphaMask = infoHeader.size >= 56 && extraHeader.size() >= 16;
+    return masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 && masks[2] == 0x000000FF &&
+           (!alphaMask || masks[3] == 0 || masks[3] == 0xFF000000);
+}
+
+/**
+ * @brief Lee y valida los headers de un archivo BMP.
+ * @param extraHeader Donde se guardan los bytes entre el info header y los píxeles.
+ * @param topDown Donde se guarda si las filas están de arriba hacia abajo. El alto queda positivo.
+ * @return True si el formato es soportado, false en caso contrario.
+ */
+static bool readHeaders(istream& file, BmpFileHeader& fileHeader, BmpInfoHeader& infoHeader,
+                        vector<uint8_t>& extraHeader, bool& topDown) {
     file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
     file.read(reinterpret_cast<char*>(&infoHeader), sizeof(infoHeader));
 
-    if (fileHeader.fileType != 0x4D42 || infoHeader.bitCount != 24 || infoHeader.compression != 0) {
+    size_t headerSize = sizeof(fileHeader) + sizeof(infoHeader);
+    size_t extraSize = fileHeader.offsetData > headerSize ? fileHeader.offsetData - headerSize : 0;
+    if (!file || extraSize > MAX_EXTRA_HEADER) {
+        cerr << "Invalid BMP header." << endl;
+        return false;
+    }
+    extraHeader.resize(extraSize);
+    file.read(reinterpret_cast<char*>(extraHeader.data()), extraSize);
+
+    bool supported = (infoHeader.bitCount == 24 && infoHeader.compression == BMP_RGB) ||
+                     (infoHeader.bitCount == 32 && (infoHeader.compression == BMP_RGB ||
+                      (infoHeader.compression == BMP_BITFIELDS && hasBgraMasks(infoHeader, extraHeader))));
+    if (fileHeader.fileType != 0x4D42 || !supported) {
         cerr << "Unsupported BMP format or compression." << endl;
         return false;
     }
 
-    if (infoHeader.width <= 0 || infoHeader.height <= 0) {
+    // Un alto negativo indica que las filas están guardadas de arriba hacia abajo
+    topDown = infoHeader.height < 0;
+    if (infoHeader.width <= 0 || infoHeader.height == 0 || infoHeader.height == INT32_MIN) {
         cerr << "Invalid image dimensions." << endl;
         return false;
     }
+    if (topDown) infoHeader.height = -infoHeader.height;
+    return true;
+}
+
+/**
+ * @brief Arma los headers (con relleno hasta el offset de los datos) tal como van al archivo.
+ */
+static vector<uint8_t> headerBytes(const BmpFileHeader& fileHeader, const BmpInfoHeader& infoHeader,
+                                   const vector<uint8_t>& extraHeader, bool topDown) {
+    size_t headerSize = sizeof(fileHeader) + sizeof(infoHeader);
+    vector<uint8_t> header(max<size_t>(fileHeader.offsetData, headerSize + extraHeader.size()), 0);
+    BmpInfoHeader fileInfo = infoHeader;
+    if (topDown) fileInfo.height = -fileInfo.height;
+    memcpy(header.data(), &fileHeader, sizeof(fileHeader));
+    memcpy(header.data() + sizeof(fileHeader), &fileInfo, sizeof(fileInfo));
+    copy(extraHeader.begin(), extraHeader.end(), header.begin() + headerSize);
+    return header;
+}
+
+/**
+ * @brief Bytes que ocupa una fila en el archivo, incluyendo el padding.
+ */
+static size_t rowBytes(const BmpInfoHeader& infoHeader) {
+    return (static_cast<size_t>(infoHeader.width) * (infoHeader.bitCount / 8) + 3) / 4 * 4;
+}
+
+/**
+ * @brief Bytes por bloque al leer o escribir filas que hay que convertir.
+ */
+static const size_t IO_CHUNK_BYTES = 1 << 20;
+
+/**
+ * @brief Lee del archivo (desde la posición actual) las filas [y, y + rows) de la imagen y las
+ * convierte al formato de memoria, por bloques.
+ * @return True si se leyeron todas las filas. Si el archivo está truncado, las filas que faltan
+ * quedan en negro y se devuelve false.
+ */
+static bool readFileRows(istream& file, BmpImage& img, int y, int rows, int bitCount, bool topDown, size_t bytes) {
+    int chunkRows = static_cast<int>(max<size_t>(1, IO_CHUNK_BYTES / bytes));
+    ScratchBuffer buffer(min(rows, chunkRows) * bytes);
+    bool complete = true;
+    for (int done = 0; done < rows; done += chunkRows) {
+        int count = min(chunkRows, rows - done);
+        size_t size = count * bytes;
+        file.read(reinterpret_cast<char*>(buffer.data()), size);
+        size_t bytesRead = file ? size : static_cast<size_t>(max<streamsize>(file.gcount(), 0));
+        if (bytesRead < size) complete = false;
+        fill(buffer.data() + bytesRead, buffer.data() + size, 0);
+        // Las filas [done, done + count) en el orden del archivo
+        int first = topDown ? y + done : y + rows - done - count;
+        img.unpackRows(buffer.data(), first, count, bitCount, topDown);
+    }
+    return complete;
+}
+
+/**
+ * @brief Convierte las filas [y, y + rows) de la imagen al formato del archivo y las escribe, por bloques.
+ * @param write Escribe los bytes dados a continuación de lo anterior; devuelve false si falla.
+ * @return True si se escribieron todas las filas.
+ */
+static bool writeFileRows(const function<bool(const uint8_t*, size_t)>& write, const BmpImage& img, int y, int rows,
+                          int bitCount, bool topDown, size_t bytes) {
+    int chunkRows = static_cast<int>(max<size_t>(1, IO_CHUNK_BYTES / bytes));
+    ScratchBuffer buffer(min(rows, chunkRows) * bytes);
+    for (int done = 0; done < rows; done += chunkRows) {
+        int count = min(chunkRows, rows - done);
+        int first = topDown ? y + done : y + rows - done - count;
+        img.packRows(buffer.data(), first, count, bitCount, topDown);
+        if (!write(buffer.data(), count * bytes)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Función de escritura para writeFileRows sobre un stream.
+ */
+static function<bool(const uint8_t*, size_t)> streamWriter(ostream& file) {
+    return [&file](const uint8_t* bytes, size_t size) {
+        file.write(reinterpret_cast<const char*>(bytes), size);
+        return static_cast<bool>(file);
+    };
+}
+
+void BmpImage::unpackRows(const uint8_t* source, int y, int rows, int bitCount, bool topDown) {
+    int width = infoHeader.width;
+    size_t bytes = (static_cast<size_t>(width) * (bitCount / 8) + 3) / 4 * 4;
+    for (int k = 0; k < rows; ++k) {
+        int row = topDown ? y + k : y + rows - 1 - k;
+        const uint8_t* in = source + k * bytes;
+        uint8_t* out = getRowData(row);
+        if (bitCount == 24) {
+            memcpy(out, in, static_cast<size_t>(width) * 3);
+        } else {
+            uint8_t* opacity = hasAlpha() ? getAlphaRow(row) : nullptr;
+            for (int x = 0; x < width; ++x) {
+                out[3 * x] = in[4 * x];
+                out[3 * x + 1] = in[4 * x + 1];
+                out[3 * x + 2] = in[4 * x + 2];
+            }
+            if (opacity) {
+                for (int x = 0; x < width; ++x) opacity[x] = in[4 * x + 3];
+            }
+        }
+        fill(out + getRowStride(), out + getRowStride() + getPadding(), 0);
+    }
+}
+
+void BmpImage::packRows(uint8_t* target, int y, int rows, int bitCount, bool topDown) const {
+    int width = infoHeader.width;
+    size_t bytes = (static_cast<size_t>(width) * (bitCount / 8) + 3) / 4 * 4;
+    for (int k = 0; k < rows; ++k) {
+        int row = topDown ? y + k : y + rows - 1 - k;
+        const uint8_t* in = getRowData(row);
+        uint8_t* out = target + k * bytes;
+        if (bitCount == 24) {
+            memcpy(out, in, static_cast<size_t>(width) * 3);
+            fill(out + static_cast<size_t>(width) * 3, out + bytes, 0);
+        } else {
+            const uint8_t* opacity = hasAlpha() ? getAlphaRow(row) : nullptr;
+            for (int x = 0; x < width; ++x) {
+                out[4 * x] = in[3 * x];
+                out[4 * x + 1] = in[3 * x + 1];
+                out[4 * x + 2] = in[3 * x + 2];
+                out[4 * x + 3] = opacity ? opacity[x] : 255;
+            }
+        }
+    }
+}
+
+bool BmpImage::load(const string& filename, LoadMode mode) {
+    ifstream file(filename, ios::binary);
+    if (!file) return false;
+
+    if (!readHeaders(file, fileHeader, infoHeader, extraHeader, topDown)) return false;
 
     int padding = getPadding();
     int rowStride = getRowStride();
 
-    size_t dataSize = (rowStride + padding) * infoHeader.height;
-    data.resize(dataSize);
+    size_t dataSize = static_cast<size_t>(rowStride + padding) * infoHeader.height;
 
+    if (!isNativeLayout()) {
+        // Se convierte al leer, por bloques, sin pasar por una copia completa del archivo
+        data.allocate(dataSize);
+        if (firstTouchSpread(dataSize)) clearPixels();
+        if (hasAlpha()) {
+            alpha.allocate(static_cast<size_t>(infoHeader.width) * infoHeader.height);
+        } else {
+            alpha = PixelBuffer();
+        }
+        file.seekg(fileHeader.offsetData, ios::beg);
+        bool complete = readFileRows(file, *this, 0, infoHeader.height, infoHeader.bitCount, topDown,
+                                     rowBytes(infoHeader));
+        if (!complete) cerr << "Truncated BMP pixel data." << endl;
+        return complete;
+    }
+    alpha = PixelBuffer();
+
+    if (mode == LoadMode::Map && data.map(filename, fileHeader.offsetData, dataSize)) {
+        return true;
+    }
+
+    // Se lee directo al buffer sin inicializarlo antes (salvo para repartir sus páginas entre los
+    // nodos NUMA de los hilos); si el archivo está truncado, el resto queda en negro y la carga falla
+    data.allocate(dataSize);
+    if (firstTouchSpread(dataSize)) clearPixels();
     file.seekg(fileHeader.offsetData, ios::beg);
     file.read(reinterpret_cast<char*>(data.data()), dataSize);
+    size_t bytesRead = file ? dataSize : static_cast<size_t>(max<streamsize>(file.gcount(), 0));
+    fill(data.data() + bytesRead, data.data() + dataSize, 0);
 
+    if (bytesRead < dataSize) {
+        cerr << "Truncated BMP pixel data." << endl;
+        return false;
+    }
     return true;
 }
 
+#ifdef BMP_POSIX_IO
+/**
+ * @brief Escribe todas las partes con writev, reintentando si la escritura queda incompleta.
+ */
+static bool writeFully(int fd, iovec* parts, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        while (count > 0 && static_cast<size_t>(written) >= parts->iov_len) {
+            written -= parts->iov_len;
+            ++parts;
+            --count;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + written;
+            parts->iov_len -= written;
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef BMP_POSIX_IO
+/**
+ * @brief Nombre de un archivo temporal al lado de filename, distinto para cada llamada del proceso.
+ */
+static string temporaryPath(const string& filename) {
+    static atomic<uint64_t> nextTemporary{0};
+    return filename + ".tmp" + to_string(getpid()) + "-" + to_string(nextTemporary++);
+}
+
+/**
+ * @brief Reemplaza target por el archivo temporal ya escrito, o lo borra si la escritura falló.
+ */
+static bool replaceWith(const string& temporary, const string& target, bool written) {
+    if (written && rename(temporary.c_str(), target.c_str()) == 0) return true;
+    remove(temporary.c_str());
+    return false;
+}
+#endif
+
 bool BmpImage::save(const std::string& filename) const {
-    std::ofstream out(filename, std::ios::binary);
+    // Headers, con relleno si el offset de los datos es mayor que 54
+    vector<uint8_t> header = headerBytes(fileHeader, infoHeader, extraHeader, topDown);
+    size_t bytes = rowBytes(infoHeader);
+
+#ifdef BMP_POSIX_IO
+    // Truncar un archivo que alguna imagen del proceso tiene mapeado rompería ese mapeo (SIGBUS en las
+    // páginas que todavía no se leyeron). En ese caso se escribe un archivo temporal al lado, con los
+    // permisos del destino, y se lo renombra encima: el mapeo se queda con el inodo viejo. Cualquier
+    // otro destino (dispositivos, enlaces, archivos sin mapear) se escribe en el lugar
+    unique_lock<mutex> lock(mappedFilesMutex);
+    struct stat target;
+    bool replace = stat(filename.c_str(), &target) == 0 && S_ISREG(target.st_mode) &&
+                   mappedFiles.count({ target.st_dev, target.st_ino }) > 0;
+    string path = replace ? temporaryPath(filename) : filename;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | (replace ? O_EXCL : O_TRUNC), 0644);
+    lock.unlock();
+    if (fd < 0) return false;
+    bool written = !replace || fchmod(fd, target.st_mode & 07777) == 0;
+
+    if (isNativeLayout()) {
+        // data ya tiene el padding al final de cada fila, así que se escribe tal cual
+        iovec parts[2] = {
+            { header.data(), header.size() },
+            { const_cast<uint8_t*>(data.data()), data.size() }
+        };
+        written = written && writeFully(fd, parts, 2);
+    } else {
+        // Las filas se convierten al formato del archivo por bloques
+        auto write = [fd](const uint8_t* bytes, size_t size) {
+            iovec part = { const_cast<uint8_t*>(bytes), size };
+            return writeFully(fd, &part, 1);
+        };
+        written = written && write(header.data(), header.size()) &&
+                  writeFileRows(write, *this, 0, infoHeader.height, infoHeader.bitCount, topDown, bytes);
+    }
+    written = close(fd) == 0 && written;
+    return replace ? replaceWith(path, filename, written) : written;
+#else
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
     if (!out) return false;
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    if (isNativeLayout()) {
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    } else {
+        writeFileRows(streamWriter(out), *this, 0, infoHeader.height, infoHeader.bitCount, topDown, bytes);
+    }
+    out.close();
+    return !out.fail();
+#endif
+}
 
-    // Escribir headers
-    out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
-    out.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+bool BmpReader::open(const string& filename) {
+    file.open(filename, ios::binary);
+    if (!file) return false;
+    return readHeaders(file, fileHeader, infoHeader, extraHeader, topDown);
+}
 
-    // Relleno si el offset es mayor que 54
-    int headerSize = sizeof(fileHeader) + sizeof(infoHeader);
-    if (fileHeader.offsetData > headerSize) {
-        int extraHeader = fileHeader.offsetData - headerSize;
-        std::vector<char> padding(extraHeader, 0);
-        out.write(padding.data(), extraHeader);
+bool BmpReader::read(int y, int rows, BmpImage& strip) {
+    if (y < 0 || rows <= 0 || y + rows > getHeight()) {
+        cerr << "Strip out of bounds." << endl;
+        return false;
+    }
+    if (strip.getWidth() != getWidth() || strip.getHeight() != rows ||
+        strip.getBitCount() != getBitCount() || strip.isTopDown() != topDown) {
+        strip.create(getWidth(), rows, getBitCount(), topDown);
     }
 
-    // Cálculo de padding
-    int rowStride = infoHeader.width * 3;
-    int padding = (4 - (rowStride % 4)) % 4;
-    std::vector<uint8_t> rowPadding(padding, 0);
+    // Las filas [y, y + rows) están contiguas en el archivo, empezando por la fila y + rows - 1 si
+    // están de abajo hacia arriba (igual que en memoria: se leen de una sola vez) o por la fila y
+    size_t bytes = rowBytes(infoHeader);
+    int firstFileRow = topDown ? y : getHeight() - y - rows;
+    file.clear();
+    file.seekg(fileHeader.offsetData + firstFileRow * bytes, ios::beg);
+    if (strip.isNativeLayout()) {
+        file.read(reinterpret_cast<char*>(strip.getRowData(rows - 1)), rows * bytes);
+    } else {
+        readFileRows(file, strip, 0, rows, getBitCount(), topDown, bytes);
+    }
+    return static_cast<bool>(file);
+}
+
+bool BmpWriter::open(const string& filename, const BmpReader& source) {
+    fileHeader = source.fileHeader;
+    infoHeader = source.infoHeader;
+    extraHeader = source.extraHeader;
+    topDown = source.topDown;
+    file.open(filename, ios::binary | ios::trunc);
+    if (!file) return false;
+    vector<uint8_t> header = headerBytes(fileHeader, infoHeader, extraHeader, topDown);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    return static_cast<bool>(file);
+}
 
-    int height = std::abs(infoHeader.height);
-    for (int y = 0; y < height; ++y) {
-        out.write(reinterpret_cast<const char*>(&data[y * rowStride]), rowStride);
-        if (padding > 0)
-            out.write(reinterpret_cast<const char*>(rowPadding.data()), padding);
+bool BmpWriter::write(const BmpImage& strip, int firstRow, int rows, int y) {
+    if (strip.getWidth() != infoHeader.width || firstRow < 0 || rows <= 0 ||
+        firstRow + rows > strip.getHeight() || y < 0 || y + rows > infoHeader.height) {
+        cerr << "Strip out of bounds." << endl;
+        return false;
     }
 
-    return true;
+    size_t bytes = rowBytes(infoHeader);
+    int firstFileRow = topDown ? y : infoHeader.height - y - rows;
+    file.seekp(fileHeader.offsetData + firstFileRow * bytes, ios::beg);
+    if (infoHeader.bitCount == 24 && !topDown) {
+        file.write(reinterpret_cast<const char*>(strip.getRowData(firstRow + rows - 1)), rows * bytes);
+    } else {
+        writeFileRows(streamWriter(file), strip, firstRow, rows, infoHeader.bitCount, topDown, bytes);
+    }
+    return static_cast<bool>(file);
+}
+
+bool BmpWriter::close() {
+    file.close();
+    return !file.fail();
+}
+
+/**
+ * @brief Campos de un header BITMAPV4 que siguen al info header de 40 bytes: las máscaras de BGRA y
+ * el espacio de color (sRGB). El resto (extremos y curvas de gamma) va en cero.
+ */
+static vector<uint8_t> bgraExtraHeader() {
+    const uint32_t fields[] = { 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000, 0x73524742 };
+    vector<uint8_t> extra(108 - sizeof(BmpInfoHeader), 0);
+    memcpy(extra.data(), fields, sizeof(fields));
+    return extra;
+}
+
+void BmpImage::create(int width, int height, int bitCount, bool topDown) {
+    if (width <= 0 || height <= 0) {
+        cerr << "Invalid image dimensions." << endl;
+        throw invalid_argument("Invalid image dimensions");
+    }
+    if (bitCount != 24 && bitCount != 32) {
+        cerr << "Unsupported BMP format or compression." << endl;
+        throw invalid_argument("Unsupported bit count");
+    }
+
+    infoHeader = BmpInfoHeader{};
+    infoHeader.size = sizeof(BmpInfoHeader);
+    infoHeader.width = width;
+    infoHeader.height = height;
+    infoHeader.bitCount = bitCount;
+    this->topDown = topDown;
+    // Las de 32 bits llevan un header V4 con las máscaras, para que el alfa se respete al abrirlas
+    extraHeader = bitCount == 32 ? bgraExtraHeader() : vector<uint8_t>();
+    if (bitCount == 32) {
+        infoHeader.size += extraHeader.size();
+        infoHeader.compression = BMP_BITFIELDS;
+    }
+
+    size_t dataSize = static_cast<size_t>(getRowStride() + getPadding()) * height;
+    infoHeader.sizeImage = rowBytes(infoHeader) * height;
+
+    fileHeader = BmpFileHeader{};
+    fileHeader.offsetData = sizeof(BmpFileHeader) + sizeof(BmpInfoHeader) + extraHeader.size();
+    fileHeader.fileSize = fileHeader.offsetData + infoHeader.sizeImage;
+
+    data.allocate(dataSize);
+    clearPixels();
+    if (bitCount == 32) {
+        size_t alphaSize = static_cast<size_t>(width) * height;
+        alpha.allocate(alphaSize);
+        fill(alpha.data(), alpha.data() + alphaSize, 255);
+    } else {
+        alpha = PixelBuffer();
+    }
+}
+
+void BmpImage::clearPixels() {
+    size_t stride = getRowStride() + getPadding();
+    int height = infoHeader.height;
+    firstTouchRows(height, stride, [&](int from, int to) {
+        // Las filas [from, to) están guardadas de abajo hacia arriba
+        fill(data.data() + (height - to) * stride, data.data() + (height - from) * stride, 0);
+    });
+}
+
+void BmpImage::swapPixels(BmpImage& other) {
+    if (other.getWidth() != getWidth() || other.getHeight() != getHeight()) {
+        cerr << "Image dimensions do not match." << endl;
+        throw invalid_argument("Image dimensions do not match");
+    }
+    swap(data, other.data);
 }
 
 RGB BmpImage::getPixel(int x, int y) const {
@@ -78,6 +613,31 @@ void BmpImage::setPixel(int x, int y, RGB color) {
     data[index + 2] = color.red;
 }
 
+/**
+ * @brief Arma una vista sobre los datos de la imagen, validando el rectángulo.
+ */
+template <typename Pixel, typename Byte>
+static BasicImageView<Pixel> makeView(Byte* data, const BmpInfoHeader& info, ptrdiff_t rowBytes, int x, int y, int width, int height) {
+    if (width < 0 || height < 0 || x < 0 || y < 0 || x + width > info.width || y + height > info.height) {
+        cerr << "View out of bounds." << endl;
+        throw invalid_argument("View out of bounds");
+    }
+    if (width == 0 || height == 0) {
+        return { nullptr, 0, width, height };
+    }
+    // Las filas están guardadas de abajo hacia arriba: bajar una fila es retroceder en memoria
+    Byte* firstRow = data + (info.height - 1 - y) * rowBytes + x * 3;
+    return { firstRow, -rowBytes, width, height };
+}
+
+ImageView BmpImage::view(int x, int y, int width, int height) {
+    return makeView<RGB>(data.data(), infoHeader, getRowStride() + getPadding(), x, y, width, height);
+}
+
+ConstImageView BmpImage::view(int x, int y, int width, int height) const {
+    return makeView<const RGB>(data.data(), infoHeader, getRowStride() + getPadding(), x, y, width, height);
+}
+
 vector<RGB> BmpImage::getSection(int xStart, int yStart, int xEnd, int yEnd) const {
     int width = xEnd - xStart;
     int height = yEnd - yStart;
@@ -86,21 +646,17 @@ vector<RGB> BmpImage::getSection(int xStart, int yStart, int xEnd, int yEnd) con
         throw invalid_argument("Invalid section dimensions");
     }
 
-    vector<RGB> sectionData(width * height);
-
     if (xStart < 0 || yStart < 0 || xStart + width > infoHeader.width || yStart + height > infoHeader.height) {
         cerr << "Section out of bounds." << endl;
         throw invalid_argument("Section out of bounds");
     }
 
+    ConstImageView section = view(xStart, yStart, width, height);
+    vector<RGB> sectionData;
+    sectionData.reserve(static_cast<size_t>(width) * height);
     for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            if (xStart + i >= infoHeader.width || yStart + j >= infoHeader.height) {
-                sectionData[(j * width + i)] = { 0, 0, 0 }; // Out of bounds, set to black
-                continue;
-            }
-            sectionData[(j * width + i)] = getPixel(xStart + i, yStart + j);
-        }
+        span<const RGB> row = section.row(j);
+        sectionData.insert(sectionData.end(), row.begin(), row.end());
     }
     return sectionData;
 }
@@ -113,9 +669,9 @@ void BmpImage::setSection(int xStart, int yStart, const vector<RGB>& sectionData
         throw invalid_argument("Invalid section dimensions");
     }
 
+    ImageView section = view(xStart, yStart, width, height);
     for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            setPixel(xStart + i, yStart + j, sectionData[j * width + i]);
-        }
+        auto rowStart = sectionData.begin() + static_cast<size_t>(j) * width;
+        copy(rowStart, rowStart + width, section.row(j).begin());
     }
-}
\ No newline at end of file
+}
@@ -6,6 +6,10 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
 
 using namespace std;
 
@@ -43,32 +47,223 @@ struct RGB {
     uint8_t green;
     uint8_t red;
 };
+static_assert(sizeof(RGB) == 3, "RGB debe ocupar exactamente los 3 bytes de un píxel BMP");
+
+/**
+ * @brief Vista rectangular (sin copia) sobre los píxeles de una imagen.
+ * @details No es dueña de los datos: apunta directamente al buffer de la imagen, así que deja de
+ * ser válida si la imagen se destruye o se vuelve a cargar. Las filas pueden no estar contiguas en
+ * memoria (por el padding y porque BMP guarda las filas de abajo hacia arriba), por eso se recorren
+ * de a una con row().
+ * @tparam Pixel RGB para una vista modificable, const RGB para una de sólo lectura.
+ */
+template <typename Pixel>
+class BasicImageView {
+public:
+    using Byte = conditional_t<is_const_v<Pixel>, const uint8_t, uint8_t>;
+
+    /**
+     * @param firstRow Puntero al primer píxel de la fila de arriba de la vista.
+     * @param stride Distancia en bytes desde una fila a la de abajo (puede ser negativa).
+     * @param width El ancho de la vista en píxeles.
+     * @param height La altura de la vista en píxeles.
+     */
+    BasicImageView(Byte* firstRow, ptrdiff_t stride, int width, int height)
+        : firstRow(firstRow), stride(stride), width(width), height(height) {}
+
+    /// Una vista de sólo lectura se puede obtener a partir de una modificable.
+    operator BasicImageView<const Pixel>() const { return { firstRow, stride, width, height }; }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /**
+     * @brief Obtiene una fila de la vista.
+     * @param j La fila, relativa a la vista (0 es la de arriba).
+     * @return Los píxeles de la fila, contiguos en memoria.
+     */
+    span<Pixel> row(int j) const {
+        return { reinterpret_cast<Pixel*>(firstRow + j * stride), static_cast<size_t>(width) };
+    }
+
+    /// Píxel (i, j), relativo a la esquina superior izquierda de la vista.
+    Pixel& operator()(int i, int j) const { return row(j)[i]; }
+
+private:
+    Byte* firstRow;
+    ptrdiff_t stride;
+    int width;
+    int height;
+};
+
+using ImageView = BasicImageView<RGB>;
+using ConstImageView = BasicImageView<const RGB>;
+
+/**
+ * @brief Buffer de los bytes de píxeles de una imagen.
+ * @details Los bytes pueden estar en memoria propia (heap) o en un mapeo privado (copy-on-write) del
+ * archivo de origen: en ese caso cargar la imagen no copia nada, y sólo se copian las páginas que
+ * los filtros modifican. Copiar un buffer siempre copia los bytes a memoria propia.
+ */
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+    PixelBuffer(const PixelBuffer& other);
+    PixelBuffer& operator=(const PixelBuffer& other);
+    PixelBuffer(PixelBuffer&& other) noexcept;
+    PixelBuffer& operator=(PixelBuffer&& other) noexcept;
+    ~PixelBuffer();
+
+    /**
+     * @brief Reserva size bytes en memoria propia, sin inicializar. Libera lo que hubiera antes.
+     * @details La memoria sale del pool de buffers (ver acquireBuffer) y vuelve a él al liberarse.
+     * Si el buffer ya tiene memoria propia suficiente, se reutiliza.
+     */
+    void allocate(size_t size);
+
+    /**
+     * @brief Mapea una región de un archivo como copia privada. Libera lo que hubiera antes.
+     * @param filename El archivo a mapear.
+     * @param offset Posición del primer byte a mapear dentro del archivo.
+     * @param size Cantidad de bytes a mapear.
+     * @return True si se pudo mapear, false si el sistema no lo soporta o el archivo es más corto.
+     */
+    bool map(const string& filename, size_t offset, size_t size);
+
+    /**
+     * @brief Indica si los bytes vienen de un mapeo del archivo.
+     */
+    bool isMapped() const { return mapBase != nullptr; }
+
+    uint8_t* data() { return bytes; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    uint8_t& operator[](size_t index) { return bytes[index]; }
+    const uint8_t& operator[](size_t index) const { return bytes[index]; }
+
+private:
+    void release();
+
+    uint8_t* bytes = nullptr;
+    size_t length = 0;
+    size_t capacity = 0;
+    void* mapBase = nullptr;
+    size_t mapLength = 0;
+    pair<uint64_t, uint64_t> mapFile; ///< Dispositivo e inodo del archivo mapeado.
+};
+
+/**
+ * @brief Modo de carga de una imagen.
+ */
+enum class LoadMode {
+    Read, ///< Lee los píxeles del archivo a memoria propia.
+    Map   ///< Mapea los píxeles del archivo (copy-on-write). Si no se puede, se leen como en Read.
+};
 
 /**
  * @brief Clase de imagen BMP.
  * Esta clase proporciona métodos para cargar, guardar y manipular imágenes BMP.
+ * @details Soporta archivos de 24 bits (BGR) y de 32 bits (BGRA, sin compresión o con las máscaras
+ * estándar), guardados de abajo hacia arriba o de arriba hacia abajo (alto negativo). En memoria los
+ * píxeles siempre están en BGR de 24 bits de abajo hacia arriba, que es lo que esperan los filtros;
+ * el canal alfa de las imágenes de 32 bits se guarda aparte y los filtros no lo modifican. Al
+ * guardar, se usa el mismo formato del archivo de origen.
  */
 class BmpImage {
 private:
     BmpFileHeader fileHeader;
-    BmpInfoHeader infoHeader;
-    vector<uint8_t> data;
+    BmpInfoHeader infoHeader; ///< El alto siempre es positivo: la orientación está en topDown.
+    vector<uint8_t> extraHeader; ///< Bytes entre el info header y los píxeles (máscaras, headers V4/V5).
+    bool topDown{false};
+    PixelBuffer data;
+    PixelBuffer alpha; ///< Canal alfa de las imágenes de 32 bits, por filas de arriba hacia abajo.
+
+    /**
+     * @brief Llena los píxeles de negro, repartiendo las filas entre los hilos (ver firstTouchRows).
+     * @note Si el buffer es un bloque reutilizado del pool, sus páginas ya están ubicadas y el reparto
+     * no las mueve de nodo.
+     */
+    void clearPixels();
 
 public:
     /**
      * @brief Carga una imagen BMP desde un archivo.
      * @param filename El nombre del archivo a cargar.
-     * @return True si la imagen se cargó correctamente, false en caso contrario.
+     * @param mode Si los píxeles se leen a memoria o se mapean desde el archivo (opcional).
+     * @return True si la imagen se cargó correctamente, false en caso contrario (también si el
+     * archivo está truncado y faltan píxeles).
+     * @note Con LoadMode::Map los filtros trabajan sobre una copia privada del archivo: el archivo
+     * nunca se modifica, aunque se guarde la imagen sobre él.
      */
-    bool load(const string& filename);
+    bool load(const string& filename, LoadMode mode = LoadMode::Read);
     /**
      * @brief Guarda la imagen en un archivo.
      * @param filename El nombre del archivo a donde se guardará la imagen. Importante incluir la extensión .bmp.
-     * @note El archivo será sobrescrito si ya existe.
+     * @note El archivo será sobrescrito si ya existe. Los headers y los píxeles (con el padding de
+     * cada fila) se escriben con una sola llamada al sistema. Si alguna imagen del proceso tiene
+     * mapeado el destino (ver LoadMode::Map), se escribe un archivo temporal de la misma carpeta que
+     * después se renombra encima, para que el mapeo siga viendo el archivo anterior entero; en otro
+     * caso se escribe en el lugar, así los dispositivos, enlaces y permisos del destino se respetan.
      * @return True si la imagen se guardó correctamente, false en caso contrario.
      */
     bool save(const string& filename) const;
 
+    /**
+     * @brief Crea una imagen nueva, con todos los píxeles en negro (y opacos, si tiene alfa).
+     * @param width El ancho de la imagen en píxeles.
+     * @param height La altura de la imagen en píxeles.
+     * @param bitCount Los bits por pixel con que se guarda: 24 o 32 (opcional).
+     * @param topDown Si se guarda con las filas de arriba hacia abajo (opcional).
+     * @throws invalid_argument Si las dimensiones no son positivas o bitCount no es 24 ni 32.
+     * @note Los headers se completan como si la imagen se hubiera cargado de un archivo.
+     */
+    void create(int width, int height, int bitCount = 24, bool topDown = false);
+
+    /**
+     * @brief Obtiene los bits por pixel del archivo (24 o 32).
+     */
+    int getBitCount() const { return infoHeader.bitCount; }
+
+    /**
+     * @brief Indica si el archivo guarda las filas de arriba hacia abajo.
+     */
+    bool isTopDown() const { return topDown; }
+
+    /**
+     * @brief Indica si la imagen tiene canal alfa (las de 32 bits).
+     */
+    bool hasAlpha() const { return infoHeader.bitCount == 32; }
+
+    /**
+     * @brief Obtiene el canal alfa de una fila (un byte por pixel). Sólo si hasAlpha().
+     * @param y La coordenada y de la fila (0 es la fila de arriba).
+     */
+    uint8_t* getAlphaRow(int y) { return &alpha[static_cast<size_t>(y) * infoHeader.width]; }
+    const uint8_t* getAlphaRow(int y) const { return &alpha[static_cast<size_t>(y) * infoHeader.width]; }
+
+    /**
+     * @brief Indica si los píxeles en memoria tienen el mismo formato que en el archivo (24 bits, de
+     * abajo hacia arriba): en ese caso se leen y se escriben sin convertir, y se pueden mapear.
+     */
+    bool isNativeLayout() const { return infoHeader.bitCount == 24 && !topDown; }
+
+    /**
+     * @brief Copia filas desde bytes con el formato de un archivo BMP.
+     * @param source Las filas tal como están en el archivo (con su relleno), en el orden del archivo.
+     * @param y La primera fila de la imagen que se copia (0 es la de arriba).
+     * @param rows Cantidad de filas.
+     * @param bitCount Los bits por pixel del archivo (24 o 32).
+     * @param topDown Si el archivo guarda las filas de arriba hacia abajo.
+     * @note El alfa se copia sólo si la imagen tiene alfa.
+     */
+    void unpackRows(const uint8_t* source, int y, int rows, int bitCount, bool topDown);
+
+    /**
+     * @brief Copia filas a bytes con el formato de un archivo BMP (la operación inversa de unpackRows).
+     * @note Si el archivo es de 32 bits y la imagen no tiene alfa, los píxeles quedan opacos.
+     */
+    void packRows(uint8_t* target, int y, int rows, int bitCount, bool topDown) const;
+
     /**
      * @brief Obtiene el ancho de la imagen.
      * @return El ancho de la imagen en píxeles.
@@ -95,6 +290,49 @@ public:
      */
     void setPixel(int x, int y, RGB color);
 
+    /**
+     * @brief Obtiene una fila de la imagen, sin copiarla.
+     * @param y La coordenada y de la fila (0 es la fila de arriba, igual que en getPixel).
+     * @return Los píxeles de la fila, contiguos en memoria. Modificarlos modifica la imagen.
+     */
+    span<RGB> getRow(int y) { return { reinterpret_cast<RGB*>(getRowData(y)), static_cast<size_t>(infoHeader.width) }; }
+    span<const RGB> getRow(int y) const { return { reinterpret_cast<const RGB*>(getRowData(y)), static_cast<size_t>(infoHeader.width) }; }
+
+    /**
+     * @brief Obtiene una vista rectangular de la imagen, sin copiarla.
+     * @param x La coordenada x de la esquina superior izquierda de la vista.
+     * @param y La coordenada y de la esquina superior izquierda de la vista.
+     * @param width El ancho de la vista en píxeles.
+     * @param height La altura de la vista en píxeles.
+     * @throws invalid_argument Si el rectángulo tiene dimensiones negativas o se sale de la imagen.
+     */
+    ImageView view(int x, int y, int width, int height);
+    ConstImageView view(int x, int y, int width, int height) const;
+
+    /**
+     * @brief Obtiene una vista de toda la imagen.
+     */
+    ImageView view() { return view(0, 0, infoHeader.width, infoHeader.height); }
+    ConstImageView view() const { return view(0, 0, infoHeader.width, infoHeader.height); }
+
+    /**
+     * @brief Obtiene un puntero a los datos de una fila.
+     * @param y La coordenada y de la fila (0 es la fila de arriba, igual que en getPixel).
+     * @return Puntero al primer byte del primer píxel de la fila. Los píxeles están empaquetados
+     * en orden azul, verde, rojo (3 bytes por píxel), sin el padding del final.
+     */
+    uint8_t* getRowData(int y) { return &data[static_cast<size_t>(infoHeader.height - 1 - y) * (getRowStride() + getPadding())]; }
+    const uint8_t* getRowData(int y) const { return &data[static_cast<size_t>(infoHeader.height - 1 - y) * (getRowStride() + getPadding())]; }
+
+    /**
+     * @brief Intercambia los píxeles con otra imagen del mismo tamaño, sin copiarlos.
+     * @param other La otra imagen.
+     * @throws invalid_argument Si las imágenes tienen distinto tamaño.
+     * @note Sirve para filtros que escriben en una imagen auxiliar: al terminar, el resultado se
+     * pasa a la imagen original y la auxiliar se queda con los píxeles viejos para el próximo paso.
+     */
+    void swapPixels(BmpImage& other);
+
     /**
      * @brief Obtiene el row stride de la imagen.
      * @return El número de bytes en una fila de datos de píxeles.
@@ -135,4 +373,78 @@ public:
     void setSection(int x, int y, const vector<RGB>& sectionData, int width, int height);
 };
 
+/**
+ * @brief Lector de imágenes BMP por franjas horizontales.
+ * @details Permite procesar imágenes que no entran en memoria: sólo se cargan las filas pedidas.
+ */
+class BmpReader {
+public:
+    /**
+     * @brief Abre un archivo BMP y lee sus headers.
+     * @return True si el archivo existe y tiene un formato soportado, false en caso contrario.
+     */
+    bool open(const string& filename);
+
+    int getWidth() const { return infoHeader.width; }
+    int getHeight() const { return infoHeader.height; }
+    int getBitCount() const { return infoHeader.bitCount; }
+    bool isTopDown() const { return topDown; }
+
+    /**
+     * @brief Lee una franja de filas.
+     * @param y La primera fila a leer (0 es la fila de arriba).
+     * @param rows Cantidad de filas a leer.
+     * @param strip Imagen donde se guarda la franja (de getWidth() x rows, con el formato del archivo).
+     * Si ya tiene ese tamaño y formato se reutiliza su memoria.
+     * @return True si se pudo leer, false en caso contrario.
+     */
+    bool read(int y, int rows, BmpImage& strip);
+
+private:
+    friend class BmpWriter;
+
+    ifstream file;
+    BmpFileHeader fileHeader;
+    BmpInfoHeader infoHeader;
+    vector<uint8_t> extraHeader;
+    bool topDown{false};
+};
+
+/**
+ * @brief Escritor de imágenes BMP por franjas horizontales.
+ */
+class BmpWriter {
+public:
+    /**
+     * @brief Crea el archivo y escribe los headers.
+     * @param filename El nombre del archivo a crear. Se sobrescribe si ya existe.
+     * @param source El lector de la imagen de entrada: se escribe con su tamaño, sus headers y su formato.
+     * @return True si se pudo crear, false en caso contrario.
+     */
+    bool open(const string& filename, const BmpReader& source);
+
+    /**
+     * @brief Escribe filas de una franja en su lugar del archivo.
+     * @param strip La franja de donde se toman las filas.
+     * @param firstRow La primera fila de strip a escribir.
+     * @param rows Cantidad de filas a escribir.
+     * @param y La fila de la imagen completa donde va firstRow.
+     * @return True si se pudo escribir, false en caso contrario.
+     */
+    bool write(const BmpImage& strip, int firstRow, int rows, int y);
+
+    /**
+     * @brief Cierra el archivo.
+     * @return True si todo lo escrito llegó al archivo, false en caso contrario.
+     */
+    bool close();
+
+private:
+    ofstream file;
+    BmpFileHeader fileHeader;
+    BmpInfoHeader infoHeader;
+    vector<uint8_t> extraHeader;
+    bool topDown{false};
+};
+
 #endif // BMPIMAGE_H
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "../BMPImage.h"
+#include "../filters/filters.h"
+#include "../filters/pipeline.h"
+#include "../utils/utils.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @brief Un caso del benchmark: un pipeline con nombre.
+ */
+struct BenchCase {
+    string name;
+    vector<FilterStep> steps;
+};
+
+/**
+ * @brief Resultado de medir un caso con un tamaño de imagen y una cantidad de hilos.
+ */
+struct BenchResult {
+    string caseName;
+    int width;
+    int height;
+    int threads;
+    double median;     // segundos
+    double p95;        // segundos
+    double mpixPerSec;
+    double gbPerSec;
+    double efficiency; // tiempo con 1 hilo / (hilos * tiempo con n hilos)
+};
+
+/**
+ * @brief Parámetros de ejemplo para cada filtro registrado. Los filtros que no están acá se miden
+ * sin parámetros.
+ */
+static const map<string, vector<string>> BENCH_PARAMS = {
+    {"threshold", {"8"}},
+    {"boxblur", {"5"}},
+    {"gaussian", {"3"}},
+    {"unsharp", {"5", "150"}},
+    {"adaptive", {"15", "5"}},
+    {"resize", {"640", "480"}},
+    {"scale", {"0.5"}},
+};
+
+/**
+ * @brief Crea una imagen sintética de unos `megapixels` millones de píxeles.
+ * @details El ancho es impar, para que las filas tengan relleno, y la proporción es 4:3. El
+ * contenido mezcla gradientes y ruido para que los filtros no vean zonas constantes.
+ */
+static BmpImage makeBenchImage(double megapixels) {
+    int width = max(1, static_cast<int>(sqrt(megapixels * 1e6 * 4 / 3))) | 1;
+    int height = max(1, static_cast<int>(megapixels * 1e6 / width));
+    BmpImage img;
+    img.create(width, height);
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        span<RGB> row = img.getRow(y);
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1664525 + 1013904223;
+            row[x] = { static_cast<uint8_t>(x * 255 / width),
+                       static_cast<uint8_t>(y * 255 / height),
+                       static_cast<uint8_t>(seed >> 24) };
+        }
+    }
+    return img;
+}
+
+/**
+ * @brief Mide un caso `reps` veces, partiendo siempre de la misma imagen.
+ * @return Los tiempos ordenados, en segundos.
+ */
+static vector<double> measure(const BenchCase& benchCase, const BmpImage& original, int threads, int reps) {
+    vector<double> times;
+    BmpImage img;
+    for (int rep = 0; rep < reps; ++rep) {
+        img = original;
+        auto start = chrono::high_resolution_clock::now();
+        applyPipelineFused(img, benchCase.steps, threads);
+        auto end = chrono::high_resolution_clock::now();
+        times.push_back(chrono::duration<double>(end - start).count());
+    }
+    sort(times.begin(), times.end());
+    return times;
+}
+
+/**
+ * @brief Percentil de una lista de tiempos ordenada (por el método del rango más cercano).
+ */
+static double percentile(const vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(ceil(p / 100 * sorted.size()));
+    return sorted[min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+/**
+ * @brief Separa una lista de valores por comas.
+ */
+static vector<string> splitList(const string& list) {
+    vector<string> values;
+    stringstream ss(list);
+    string token;
+    while (getline(ss, token, ',')) {
+        if (!token.empty()) values.push_back(token);
+    }
+    return values;
+}
+
+static void writeJson(const string& filename, const vector<BenchResult>& results, int reps) {
+    ofstream out(filename);
+    out << "{\n  \"reps\": " << reps << ",\n  \"hardware_threads\": " << thread::hardware_concurrency()
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "    {\"case\": \"" << r.caseName << "\", \"width\": " << r.width << ", \"height\": " << r.height
+            << ", \"threads\": " << r.threads << ", \"median_s\": " << r.median << ", \"p95_s\": " << r.p95
+            << ", \"mpix_per_s\": " << r.mpixPerSec << ", \"gb_per_s\": " << r.gbPerSec
+            << ", \"efficiency\": " << r.efficiency << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    // Las opciones tienen el mismo formato que las de main (--nombre=valor), pero sin argumentos fijos
+    map<string, string> options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help" || arg.rfind("--", 0) != 0) {
+            cerr << "Uso: " << argv[0] << " [opciones]\n";
+            cerr << "Opciones:\n";
+            cerr << "   --sizes=<mp,...>     Tamaños de imagen en megapíxeles (por defecto 1,10,100)\n";
+            cerr << "   --threads=<n>        Cantidad máxima de hilos (por defecto, uno por núcleo)\n";
+            cerr << "   --reps=<n>           Repeticiones por medición (por defecto 5)\n";
+            cerr << "   --filter=<nombre>    Mide sólo los casos con ese nombre\n";
+            cerr << "   --output=<archivo>   Archivo JSON con los resultados (por defecto bench.json)\n";
+            return arg.rfind("--", 0) == 0 ? 0 : 1;
+        }
+        size_t equals = arg.find('=');
+        options[arg.substr(2, equals == string::npos ? string::npos : equals - 2)] =
+            equals == string::npos ? "" : arg.substr(equals + 1);
+    }
+
+    vector<string> sizes = splitList(options.count("sizes") ? options["sizes"] : "1,10,100");
+    int maxThreads = options.count("threads") ? stoi(options["threads"]) : max(1u, thread::hardware_concurrency());
+    int reps = options.count("reps") ? max(1, stoi(options["reps"])) : 5;
+    string output = options.count("output") ? options["output"] : "bench.json";
+
+    registerFilters();
+    initThreadPool(maxThreads);
+    maxThreads = threadPool().size();
+
+    // Cada filtro registrado por separado, y algunos pipelines representativos
+    vector<BenchCase> cases;
+    for (const string& name : registeredFilters()) {
+        auto params = BENCH_PARAMS.find(name);
+        cases.push_back({ name, { { name, params != BENCH_PARAMS.end() ? params->second : vector<string>{} } } });
+    }
+    cases.push_back({ "pipeline:point", { {"negative", {}}, {"threshold", {"8"}}, {"negative", {}} } });
+    cases.push_back({ "pipeline:long", { {"boxblur", {"5"}}, {"negative", {}}, {"unsharp", {"3", "150"}},
+                                         {"grayscale", {}}, {"adaptive", {"7", "4"}} } });
+    if (options.count("filter")) {
+        string only = options["filter"];
+        erase_if(cases, [&](const BenchCase& c) { return c.name != only; });
+    }
+
+    // 1, 2, 4, ... hilos, y siempre el máximo
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    vector<BenchResult> results;
+    cout << left << setw(16) << "caso" << right << setw(12) << "imagen" << setw(8) << "hilos" << setw(12) << "mediana ms"
+         << setw(10) << "p95 ms" << setw(12) << "MPix/s" << setw(10) << "GB/s" << setw(12) << "eficiencia" << "\n";
+    for (const string& size : sizes) {
+        BmpImage original = makeBenchImage(stod(size));
+        double pixels = static_cast<double>(original.getWidth()) * original.getHeight();
+        for (const BenchCase& benchCase : cases) {
+            double single = 0;
+            for (int threads : threadCounts) {
+                vector<double> times = measure(benchCase, original, threads, reps);
+                BenchResult r;
+                r.caseName = benchCase.name;
+                r.width = original.getWidth();
+                r.height = original.getHeight();
+                r.threads = threads;
+                r.median = percentile(times, 50);
+                r.p95 = percentile(times, 95);
+                r.mpixPerSec = pixels / r.median / 1e6;
+                // Cada paso lee y escribe la imagen completa una vez (3 bytes por píxel de ida y de vuelta)
+                r.gbPerSec = pixels * 6 * benchCase.steps.size() / r.median / 1e9;
+                if (threads == 1) single = r.median;
+                r.efficiency = single > 0 ? single / (threads * r.median) : 0;
+                results.push_back(r);
+
+                cout << left << setw(16) << r.caseName << right << setw(12) << (to_string(r.width) + "x" + to_string(r.height))
+                     << setw(8) << threads << fixed << setprecision(2) << setw(12) << r.median * 1e3 << setw(10) << r.p95 * 1e3
+                     << setw(12) << r.mpixPerSec << setw(10) << r.gbPerSec << setw(12) << r.efficiency << "\n";
+            }
+        }
+        releaseFilterBuffers();
+    }
+
+    writeJson(output, results, reps);
+    cout << "Resultados guardados en " << output << endl;
+    return 0;
+}
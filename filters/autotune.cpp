@@ -0,0 +1,276 @@
+#include "autotune.h"
+#include "filters.h"
+#include "resize.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+/**
+ * @brief Calibraciones conocidas, por clave (ver calibrationKey).
+ */
+struct CalibrationCache {
+    mutex lock;
+    bool loaded = false;
+    string file = defaultCalibrationFile();
+    map<string, vector<ThreadCost>> costs;
+    set<string> calibrating;     ///< Claves que algún hilo está calibrando.
+    condition_variable finished; ///< Se avisa cada vez que termina una calibración.
+};
+
+static CalibrationCache& calibrationCache() {
+    static CalibrationCache cache;
+    return cache;
+}
+
+string defaultCalibrationFile() {
+    string dir;
+    if (const char* cache = getenv("XDG_CACHE_HOME"); cache && *cache) {
+        dir = cache;
+    } else if (const char* home = getenv("HOME"); home && *home) {
+        dir = string(home) + "/.cache";
+    } else {
+        return "";
+    }
+    char host[256] = "local";
+    gethostname(host, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    return dir + "/tp2/hilos-" + host + ".txt";
+}
+
+void setCalibrationFile(const string& path) {
+    CalibrationCache& cache = calibrationCache();
+    lock_guard<mutex> lock(cache.lock);
+    cache.file = path;
+    cache.loaded = false;
+    cache.costs.clear();
+}
+
+/**
+ * @brief Clave de un paso en el archivo: el nombre del filtro.
+ * @details Los tamaños (del kernel, del resultado) y los demás parámetros numéricos no cambian el
+ * costo por pixel de ningún filtro, así que no entran en la clave: si no, cada tamaño de kernel
+ * nuevo volvería a calibrar. La máscara de desenfoque con desenfoque gaussiano es otro algoritmo y
+ * tiene su propia clave.
+ */
+static string calibrationKey(const FilterStep& step) {
+    if (step.name == "unsharp" && unsharpUsesGaussian(step.parameters)) return "unsharp:gaussian";
+    return step.name;
+}
+
+/**
+ * @brief Indica si el costo del paso depende del tamaño del resultado en lugar del de la imagen.
+ */
+static bool changesSize(const FilterStep& step) {
+    return step.name == "resize" || step.name == "scale";
+}
+
+/**
+ * @brief Píxeles con los que se estima el costo del paso: los del resultado en resize y scale, y
+ * los de la imagen en los demás filtros.
+ */
+static double costPixels(const FilterStep& step, int width, int height) {
+    pair<int, int> size = { width, height };
+    if (step.name == "resize") size = resizeTarget(step.parameters, width, height);
+    if (step.name == "scale") size = scaleTarget(step.parameters, width, height);
+    return static_cast<double>(size.first) * size.second;
+}
+
+/**
+ * @brief Lee el archivo de calibración, si existe. Las líneas mal formadas se ignoran.
+ */
+static void loadCalibration(CalibrationCache& cache) {
+    cache.loaded = true;
+    if (cache.file.empty()) return;
+    ifstream file(cache.file);
+    string line;
+    while (getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == string::npos) continue;
+        istringstream values(line.substr(tab + 1));
+        vector<ThreadCost> costs;
+        ThreadCost cost;
+        while (values >> cost.threads >> cost.perPixel >> cost.fixed) costs.push_back(cost);
+        if (!costs.empty()) cache.costs[line.substr(0, tab)] = costs;
+    }
+}
+
+/**
+ * @brief Agrega una calibración al archivo. Si no se puede escribir, sólo queda en memoria.
+ */
+static void saveCalibration(const CalibrationCache& cache, const string& key, const vector<ThreadCost>& costs) {
+    if (cache.file.empty()) return;
+    error_code error;
+    filesystem::path parent = filesystem::path(cache.file).parent_path();
+    if (!parent.empty()) filesystem::create_directories(parent, error);
+    ofstream file(cache.file, ios::app);
+    file << key << '\t';
+    for (const ThreadCost& cost : costs) {
+        file << cost.threads << ' ' << cost.perPixel << ' ' << cost.fixed << ' ';
+    }
+    file << '\n';
+}
+
+/**
+ * @brief Imagen sintética para calibrar: gradientes con ruido, para que no haya zonas constantes.
+ */
+static BmpImage calibrationImage(int width, int height) {
+    BmpImage img;
+    img.create(width, height);
+    uint32_t noise = 12345;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* pixels = img.getRowData(y);
+        for (int x = 0; x < width; ++x) {
+            noise = noise * 1103515245 + 12345;
+            pixels[3 * x] = static_cast<uint8_t>(x * 255 / width);
+            pixels[3 * x + 1] = static_cast<uint8_t>(y * 255 / height);
+            pixels[3 * x + 2] = static_cast<uint8_t>(noise >> 24);
+        }
+    }
+    return img;
+}
+
+/**
+ * @brief Menor tiempo, en nanosegundos, de aplicar el paso sobre una copia de source.
+ */
+static double measure(const FilterStep& step, const BmpImage& source, int threads, int reps) {
+    double best = numeric_limits<double>::infinity();
+    BmpImage img;
+    for (int rep = 0; rep < reps; ++rep) {
+        img = source;
+        auto start = chrono::steady_clock::now();
+        applyFilter(img, step.name, step.parameters, threads);
+        best = min(best, static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()));
+    }
+    return best;
+}
+
+vector<ThreadCost> calibrateFilter(const FilterStep& step, int maxThreads) {
+    BmpImage small = calibrationImage(96, 64);
+    BmpImage large = calibrationImage(1024, 768);
+    // Con un tamaño fijo de resultado las dos mediciones harían el mismo trabajo de salida: resize y
+    // scale se miden reduciendo a la mitad, que cuesta lo mismo por pixel de resultado
+    FilterStep measured = changesSize(step) ? FilterStep{ "scale", { "0.5" } } : step;
+    double smallPixels = costPixels(measured, 96, 64), largePixels = costPixels(measured, 1024, 768);
+
+    vector<ThreadCost> costs;
+    for (int threads = 1; ; threads = min(2 * threads, maxThreads)) {
+        double smallTime = measure(measured, small, threads, 5);
+        double largeTime = measure(measured, large, threads, 3);
+        double perPixel = max(0.0, (largeTime - smallTime) / (largePixels - smallPixels));
+        double fixed = max(0.0, smallTime - perPixel * smallPixels);
+        costs.push_back({ threads, perPixel, fixed });
+        if (threads >= maxThreads) break;
+    }
+    return costs;
+}
+
+/**
+ * @brief Costos del paso con hasta maxThreads threads: los guardados o, si faltan, los de calibrarlo.
+ */
+static vector<ThreadCost> calibratedCosts(const FilterStep& step, int maxThreads) {
+    CalibrationCache& cache = calibrationCache();
+    string key = calibrationKey(step);
+    auto sufficient = [&](const vector<ThreadCost>& costs) {
+        return any_of(costs.begin(), costs.end(), [&](const ThreadCost& cost) { return cost.threads >= maxThreads; });
+    };
+    vector<ThreadCost> costs;
+    {
+        unique_lock<mutex> lock(cache.lock);
+        if (!cache.loaded) loadCalibration(cache);
+        // Si otro hilo (otro trabajo del servidor) ya está calibrando la misma clave, se espera su
+        // resultado en lugar de medir dos veces a la vez y guardar dos líneas
+        cache.finished.wait(lock, [&] { return !cache.calibrating.count(key); });
+        auto found = cache.costs.find(key);
+        if (found != cache.costs.end()) costs = found->second;
+        if (!sufficient(costs)) cache.calibrating.insert(key);
+    }
+    // Se calibra sin tomar el lock: el filtro usa el pool, que puede correr otras tareas mientras espera
+    if (!sufficient(costs)) {
+        try {
+            costs = calibrateFilter(step, maxThreads);
+        } catch (...) {
+            lock_guard<mutex> lock(cache.lock);
+            cache.calibrating.erase(key);
+            cache.finished.notify_all();
+            throw;
+        }
+        lock_guard<mutex> lock(cache.lock);
+        cache.costs[key] = costs;
+        saveCalibration(cache, key, costs);
+        cache.calibrating.erase(key);
+        cache.finished.notify_all();
+    }
+    return costs;
+}
+
+int autoThreads(const FilterStep& step, int width, int height, int maxThreads) {
+    maxThreads = max(1, maxThreads);
+    if (maxThreads == 1) return 1;
+    vector<ThreadCost> costs = calibratedCosts(step, maxThreads);
+
+    double pixels = costPixels(step, width, height);
+    int best = 1;
+    double bestCost = numeric_limits<double>::infinity();
+    for (const ThreadCost& cost : costs) {
+        if (cost.threads > maxThreads) continue;
+        double estimate = cost.fixed + cost.perPixel * pixels;
+        if (estimate < bestCost) {
+            bestCost = estimate;
+            best = cost.threads;
+        }
+    }
+    return best;
+}
+
+void calibrateSteps(const vector<FilterStep>& steps, int maxThreads) {
+    if (maxThreads <= 1) return;
+    for (const FilterStep& step : steps) {
+        try {
+            calibratedCosts(step, maxThreads);
+        } catch (const exception&) {
+            // El paso falla igual al aplicarlo, y ahí se informa el error
+        }
+    }
+}
+
+vector<FilterStep> calibrationSamples() {
+    // Parámetros válidos para los filtros que los necesitan; sus valores no cambian el costo por pixel
+    static const map<string, vector<string>> parameters = {
+        { "adaptive", { "7", "4" } }, { "boxblur", { "5" } }, { "gaussian", { "2" } },
+        { "resize", { "2", "2" } }, { "scale", { "0.5" } }, { "threshold", { "4" } },
+        { "unsharp", { "5", "100" } },
+    };
+    vector<FilterStep> samples;
+    for (const string& name : registeredFilters()) {
+        auto found = parameters.find(name);
+        samples.push_back({ name, found != parameters.end() ? found->second : vector<string>() });
+    }
+    if (find_if(samples.begin(), samples.end(), [](const FilterStep& s) { return s.name == "unsharp"; }) != samples.end()) {
+        samples.push_back({ "unsharp", { "2", "100", "gaussian" } });
+    }
+    return samples;
+}
+
+int stepThreads(int threads, const FilterStep& step, int width, int height) {
+    if (threads != AUTO_THREADS) return threads;
+    return autoThreads(step, width, height, threadPool().size());
+}
+
+int stepsThreads(int threads, const vector<FilterStep>& steps, int width, int height) {
+    if (threads != AUTO_THREADS) return threads;
+    int result = 1;
+    for (const FilterStep& step : steps) {
+        result = max(result, autoThreads(step, width, height, threadPool().size()));
+    }
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "../utils/utils.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Cantidad de threads que pide elegirlos automáticamente para cada paso (ver autoThreads).
+ * @details Los pipelines la aceptan en lugar de una cantidad fija. Un filtro que la recibe
+ * directamente usa un solo hilo.
+ */
+const int AUTO_THREADS = -1;
+
+/**
+ * @brief Costo medido de un filtro con una cantidad de threads: fixed + perPixel * píxeles.
+ */
+struct ThreadCost {
+    int threads;
+    double perPixel; ///< Nanosegundos por pixel (del resultado, en resize y scale).
+    double fixed;    ///< Nanosegundos fijos por aplicación (repartir el trabajo, despertar los hilos).
+};
+
+/**
+ * @brief Elige cuántos threads usar para un paso sobre una imagen de un tamaño dado.
+ * @param step El paso del pipeline (el filtro y sus parámetros).
+ * @param width, height El tamaño de la imagen.
+ * @param maxThreads La cantidad máxima de threads (normalmente el tamaño del pool).
+ * @return La cantidad con menor costo estimado, entre 1 y maxThreads.
+ * @details La calibración es por filtro, sin los tamaños ni los demás parámetros numéricos, que no
+ * cambian el costo por pixel. Si el filtro todavía no se calibró se lo calibra ahora (ver
+ * calibrateFilter) y el resultado se guarda en el archivo de calibración, así que las corridas
+ * siguientes en la misma máquina no vuelven a medir; para no medir con el pool ocupado por otros
+ * trabajos conviene calibrar antes de empezar (ver calibrateSteps). Con imágenes chicas el costo fijo de repartir
+ * el trabajo domina y conviene usar pocos hilos; con imágenes grandes, los filtros que escalan usan
+ * todos, y los que están limitados por la memoria dejan de sumar hilos cuando ya no ganan nada.
+ * @throws Lo que lance el filtro al calibrarlo (por ejemplo, si los parámetros son inválidos).
+ */
+int autoThreads(const FilterStep& step, int width, int height, int maxThreads);
+
+/**
+ * @brief Resuelve la cantidad de threads de un paso: threads, o autoThreads si es AUTO_THREADS.
+ * @note Con AUTO_THREADS el máximo es el tamaño del pool global.
+ */
+int stepThreads(int threads, const FilterStep& step, int width, int height);
+
+/**
+ * @brief Resuelve la cantidad de threads de varios pasos que se aplican juntos (por ejemplo, por
+ * bloques): threads, o el máximo de autoThreads entre los pasos si es AUTO_THREADS.
+ */
+int stepsThreads(int threads, const vector<FilterStep>& steps, int width, int height);
+
+/**
+ * @brief Mide el costo de un filtro con 1, 2, 4, ... y maxThreads threads.
+ * @details Aplica el filtro sobre dos imágenes sintéticas (una chica y otra de 1024 x 768) y ajusta
+ * con los dos tiempos el costo fijo y el costo por pixel de cada cantidad de threads. Cada medición
+ * es el mínimo de unas pocas repeticiones. Tarda del orden de decenas de milisegundos por filtro.
+ * resize y scale se miden reduciendo las imágenes a la mitad y se ajustan por pixel del resultado.
+ */
+vector<ThreadCost> calibrateFilter(const FilterStep& step, int maxThreads);
+
+/**
+ * @brief Calibra los pasos que todavía no tienen calibración, antes de empezar a procesar.
+ * @details Así autoThreads no mide en medio de un trabajo, con el pool cargado por otros trabajos
+ * (y guardando para siempre costos inflados). Los pasos con parámetros inválidos se saltean: fallan
+ * al aplicarlos.
+ */
+void calibrateSteps(const vector<FilterStep>& steps, int maxThreads);
+
+/**
+ * @brief Un paso de ejemplo por cada filtro registrado (y por cada variante con su propia
+ * calibración), para calibrar todo al arrancar el modo servidor.
+ */
+vector<FilterStep> calibrationSamples();
+
+/**
+ * @brief Cambia el archivo donde se guardan las calibraciones y descarta las que estaban en memoria.
+ * @param path El archivo. Si es vacío, las calibraciones no se guardan.
+ * @details Por defecto es defaultCalibrationFile(). El archivo es de texto, con una línea por filtro:
+ * la clave (ver autoThreads), un tab y los ThreadCost separados por espacios.
+ */
+void setCalibrationFile(const string& path);
+
+/**
+ * @brief Archivo de calibración por defecto: uno por máquina en el directorio de caché del usuario
+ * ($XDG_CACHE_HOME/tp2 o ~/.cache/tp2), o vacío si no hay un directorio de caché.
+ */
+string defaultCalibrationFile();
+
+#endif // AUTOTUNE_H
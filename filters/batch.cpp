@@ -0,0 +1,148 @@
+#include "batch.h"
+#include "autotune.h"
+#include "pipeline.h"
+#include "../BMPImage.h"
+#include "../utils/queue.h"
+#include "../utils/threadpool.h"
+#include "../utils/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+vector<string> listBatchInputs(const string& input) {
+    vector<string> inputs;
+    if (fs::is_directory(input)) {
+        for (const auto& entry : fs::directory_iterator(input)) {
+            string extension = entry.path().extension().string();
+            transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() && extension == ".bmp") {
+                inputs.push_back(entry.path().string());
+            }
+        }
+        sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    ifstream list(input);
+    if (!list) {
+        throw runtime_error("No se pudo leer la lista de imágenes '" + input + "'");
+    }
+    string line;
+    while (getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) inputs.push_back(line);
+    }
+    return inputs;
+}
+
+/**
+ * @brief Imagen en tránsito entre las etapas del lote.
+ */
+struct BatchItem {
+    BmpImage image;
+    string outputFile;
+};
+
+BatchStats applyPipelineBatch(const vector<string>& inputs, const string& outputDir, const vector<FilterStep>& steps, int threads) {
+    // Validar el pipeline antes de arrancar las etapas
+    pipelineHalo(steps);
+    fs::create_directories(outputDir);
+
+    // Con AUTO_THREADS se filtran tantas imágenes a la vez como hilos tenga el pool
+    int workers = threads == AUTO_THREADS ? threadPool().size() : clamp(threads, 1, threadPool().size());
+    BoundedQueue<BatchItem> loaded(workers);
+    BoundedQueue<BatchItem> filtered(workers);
+    atomic<int> processed{0}, failed{0};
+
+    // Dos entradas con el mismo nombre de archivo (a/x.bmp y b/x.bmp) irían a la misma salida: sólo
+    // se procesa la primera, y las demás cuentan como fallidas
+    vector<string> outputFiles;
+    vector<bool> repeated;
+    set<string> seen;
+    for (const auto& input : inputs) {
+        outputFiles.push_back((fs::path(outputDir) / fs::path(input).filename()).string());
+        repeated.push_back(!seen.insert(outputFiles.back()).second);
+    }
+
+    thread reader([&] {
+        setTraceThreadName("lectura");
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const string& input = inputs[i];
+            if (repeated[i]) {
+                cerr << "La imagen " << input << " se guardaría en " << outputFiles[i]
+                     << ", que ya es la salida de otra imagen del lote\n";
+                ++failed;
+                continue;
+            }
+            BatchItem item;
+            item.outputFile = outputFiles[i];
+            bool loadedOk;
+            {
+                TraceScope trace("etapa", "lectura");
+                loadedOk = item.image.load(input, LoadMode::Map);
+            }
+            if (!loadedOk) {
+                cerr << "No se pudo cargar la imagen " << input << "\n";
+                ++failed;
+                continue;
+            }
+            if (!loaded.push(move(item))) break;
+        }
+        loaded.close();
+    });
+
+    thread writer([&] {
+        setTraceThreadName("escritura");
+        BatchItem item;
+        while (filtered.pop(item)) {
+            bool savedOk;
+            {
+                TraceScope trace("etapa", "escritura");
+                savedOk = item.image.save(item.outputFile);
+            }
+            if (savedOk) {
+                ++processed;
+            } else {
+                cerr << "No se pudo guardar la imagen " << item.outputFile << "\n";
+                ++failed;
+            }
+            item = BatchItem();
+        }
+    });
+
+    try {
+        // Cada hilo filtra imágenes completas: con muchas imágenes no hace falta repartir cada una
+        threadPool().run(workers, [&](int, int) {
+            BatchItem item;
+            while (loaded.pop(item)) {
+                try {
+                    applyPipelineFused(item.image, steps, 1);
+                } catch (...) {
+                    // Cortar el lote: los demás hilos terminan con lo que ya sacaron de la cola
+                    loaded.close();
+                    filtered.close();
+                    throw;
+                }
+                if (!filtered.push(move(item))) return;
+            }
+        });
+    } catch (...) {
+        loaded.close();
+        filtered.close();
+        reader.join();
+        writer.join();
+        throw;
+    }
+
+    filtered.close();
+    reader.join();
+    writer.join();
+    return { processed.load(), failed.load() };
+}
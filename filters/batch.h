@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "../utils/utils.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Resultado de procesar un lote de imágenes.
+ */
+struct BatchStats {
+    int processed = 0; ///< Imágenes filtradas y guardadas.
+    int failed = 0;    ///< Imágenes que no se pudieron leer o guardar.
+};
+
+/**
+ * @brief Obtiene las imágenes de entrada de un lote.
+ * @param input Directorio (se toman sus archivos .bmp, ordenados por nombre) o archivo de texto con
+ * una ruta por línea (se ignoran las líneas vacías).
+ * @return Las rutas de las imágenes.
+ * @throws runtime_error Si input no existe o no se puede leer.
+ */
+vector<string> listBatchInputs(const string& input);
+
+/**
+ * @brief Aplica el mismo pipeline a muchas imágenes, solapando lectura, filtrado y escritura.
+ * @param inputs Rutas de las imágenes de entrada.
+ * @param outputDir Directorio de salida (se crea si no existe). Cada imagen se guarda con el mismo
+ * nombre de archivo que su entrada. Si varias entradas tienen el mismo nombre (en carpetas
+ * distintas), sólo se procesa la primera y las demás se cuentan en `failed`.
+ * @param steps Pasos del pipeline.
+ * @param threads Número de threads que filtran a la vez (con AUTO_THREADS, todos los del pool).
+ * @details Un hilo lee las imágenes, los hilos del pool las filtran (cada uno una imagen completa,
+ * con applyPipelineFused) y otro hilo las guarda. Las etapas se comunican con colas acotadas, así
+ * que mientras se lee o escribe un archivo la CPU sigue filtrando, y en memoria hay como mucho unas
+ * pocas imágenes por hilo. Las imágenes que no se pueden leer o guardar se cuentan en `failed` y el
+ * lote sigue con las demás.
+ * @throws runtime_error Si algún filtro no está registrado (y lo que lance cada filtro).
+ */
+BatchStats applyPipelineBatch(const vector<string>& inputs, const string& outputDir, const vector<FilterStep>& steps, int threads);
+
+#endif // BATCH_H
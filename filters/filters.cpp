@@ -3,6 +3,19 @@
 #include <thread>
 #include <unistd.h>
 #include <semaphore>
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include "gaussian.h"
+#include "histogram.h"
+#include "pixelmath.h"
+#include "integral.h"
+#include "resize.h"
+#include "simd.h"
+#include "../utils/bufferpool.h"
+#include "../utils/threadpool.h"
+#include "../utils/trace.h"
 
 /**
  * @brief Estructura para almacenar los distintos filtros disponibles para aplicar a las imágenes.
@@ -16,54 +29,555 @@ map<string, FilterFunc> filterRegistry = {
 void applyFilter(BmpImage& img, const string& filterName, const vector<string>& params, int threads) {
     auto it = filterRegistry.find(filterName);
     if (it != filterRegistry.end()) {
+        TraceScope trace("filtro", filterName);
         it->second(img, params, threads);
     } else {
         throw runtime_error("Filtro '" + filterName + "' no registrado.");
     }
 }
 
-void registerFilter(const string& name, FilterFunc func) {
+vector<string> registeredFilters() {
+    vector<string> names;
+    for (const auto& entry : filterRegistry) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+/**
+ * @brief Alcance de cada filtro registrado (sólo de los que leen píxeles vecinos).
+ */
+map<string, FilterReach> reachRegistry;
+
+/**
+ * @brief Forma por filas de cada filtro registrado (sólo de los punto a punto).
+ */
+map<string, PointStage> pointRegistry;
+
+/**
+ * @brief Versión sobre planos de cada filtro registrado (sólo de los que la tienen).
+ */
+map<string, PlanarFilterFunc> planarRegistry;
+
+/**
+ * @brief Filtros que necesitan la imagen completa.
+ */
+set<string> wholeImageFilters;
+
+void registerFilter(const string& name, FilterFunc func, FilterReach reach, PointStage point) {
     filterRegistry[name] = func;
+    planarRegistry.erase(name);
+    wholeImageFilters.erase(name);
+    if (reach) {
+        reachRegistry[name] = reach;
+    } else {
+        reachRegistry.erase(name);
+    }
+    if (point) {
+        pointRegistry[name] = point;
+    } else {
+        pointRegistry.erase(name);
+    }
+}
+
+void registerPlanarFilter(const string& name, PlanarFilterFunc func) {
+    planarRegistry[name] = func;
+}
+
+void registerWholeImageFilter(const string& name) {
+    wholeImageFilters.insert(name);
+}
+
+bool needsWholeImage(const string& filterName) {
+    if (filterRegistry.find(filterName) == filterRegistry.end()) {
+        throw runtime_error("Filtro '" + filterName + "' no registrado.");
+    }
+    return wholeImageFilters.count(filterName) > 0;
 }
 
-void applyPixelFilter(BmpImage& img, function<RGB(const RGB&, const vector<string>&)> pixelFunc, const vector<string>& params, int threads) {
-    // Completar (una vez que estén todos los filtros de la parte 1 implementados)
+bool applyPlanarFilter(PlanarImage& img, const string& filterName, const vector<string>& params, int threads) {
+    if (filterRegistry.find(filterName) == filterRegistry.end()) {
+        throw runtime_error("Filtro '" + filterName + "' no registrado.");
+    }
+    auto it = planarRegistry.find(filterName);
+    if (it == planarRegistry.end()) return false;
+    TraceScope trace("filtro", filterName);
+    it->second(img, params, threads);
+    return true;
 }
 
-void applyKernelFilter(BmpImage& img, function<RGB(const BmpImage&, int, int, const vector<string>&)> kernelFunc, const vector<string>& params, int threads) {
-    // Completar (una vez que estén todos los filtros de la parte 1 implementados)
+bool compilePointStep(PointProgram& program, const string& filterName, const vector<string>& params) {
+    if (filterRegistry.find(filterName) == filterRegistry.end()) {
+        throw runtime_error("Filtro '" + filterName + "' no registrado.");
+    }
+    auto it = pointRegistry.find(filterName);
+    if (it == pointRegistry.end()) return false;
+    it->second(program, params);
+    return true;
+}
+
+int filterReach(const string& filterName, const vector<string>& params) {
+    if (filterRegistry.find(filterName) == filterRegistry.end()) {
+        throw runtime_error("Filtro '" + filterName + "' no registrado.");
+    }
+    auto it = reachRegistry.find(filterName);
+    return it != reachRegistry.end() ? it->second(params) : 0;
+}
+
+/**
+ * @brief Luminancia en punto fijo de un pixel (ver pixelmath.h).
+ */
+static uint8_t luminance(const RGB& pixel) {
+    return luminance(pixel.blue, pixel.green, pixel.red);
+}
+
+int kernelRadius(const vector<string>& params) {
+    if (params.empty()) {
+        throw invalid_argument("Falta el tamaño del kernel");
+    }
+    int size = stoi(params[0]);
+    if (size <= 0) {
+        throw invalid_argument("El tamaño del kernel debe ser positivo");
+    }
+    return size / 2;
+}
+
+int rowGrain(const BmpImage& img, int grain) {
+    if (grain > 0) return grain;
+    return max(1, 16384 / max(1, img.getWidth()));
+}
+
+void applyPixelFilter(BmpImage& img, function<RGB(const RGB&, const vector<string>&)> pixelFunc, const vector<string>& params, int threads, int grain) {
+    applyPixelOp(img, [&](const RGB& pixel) { return pixelFunc(pixel, params); }, threads, grain);
+}
+
+/**
+ * @brief Imagen auxiliar donde los filtros con kernel escriben su resultado.
+ * @details Es una por hilo que aplica filtros (así varios pipelines pueden correr a la vez) y se
+ * reutiliza entre pasos: después de cada paso se intercambia con la imagen filtrada (ping-pong).
+ */
+static thread_local BmpImage kernelScratch;
+
+BmpImage& kernelScratchFor(const BmpImage& img) {
+    if (kernelScratch.getWidth() != img.getWidth() || kernelScratch.getHeight() != img.getHeight()) {
+        kernelScratch.create(img.getWidth(), img.getHeight());
+    }
+    return kernelScratch;
+}
+
+void releaseFilterBuffers() {
+    kernelScratch = BmpImage();
+    releasePlanarBuffers();
+}
+
+void applyKernelFilter(BmpImage& img, function<RGB(const BmpImage&, int, int, const vector<string>&)> kernelFunc, const vector<string>& params, int threads, int grain) {
+    applyKernelOp(img, [&](const BmpImage& source, int x, int y) { return kernelFunc(source, x, y, params); }, threads, grain);
+}
+
+/**
+ * @brief Aplica sobre img, en el lugar, una operación que depende del pixel y de su posición.
+ * @details Es para los filtros que leen sus vecinos de una tabla auxiliar (la imagen integral) en
+ * lugar de la imagen, así que pueden escribir encima sin la imagen auxiliar de applyKernelOp.
+ * @tparam PositionOp Tipo con `RGB operator()(int x, int y, const RGB& pixel) const`.
+ */
+template <typename PositionOp>
+static void applyPositionOp(BmpImage& img, const PositionOp& op, int threads) {
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), rowGrain(img, 0), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            span<RGB> row = img.getRow(y);
+            for (int x = 0; x < width; ++x) {
+                row[x] = op(x, y, row[x]);
+            }
+        }
+    });
 }
 
 void identityFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    // No hay nada que hacer
+}
+
+/**
+ * @brief Aplica una función sobre cada fila de la imagen, usando múltiples hilos.
+ * @details Es la versión "por fila" de applyPixelFilter para los filtros con kernels vectoriales:
+ * la función recibe los bytes de la fila y la cantidad de píxeles.
+ */
+static void applyRowFilter(BmpImage& img, const function<void(uint8_t*, int)>& rowFunc, int threads) {
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), rowGrain(img, 0), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            rowFunc(img.getRowData(y), width);
+        }
+    });
 }
 
 void negativeFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    applyRowFilter(img, negateRow, threads);
 }
 
 void grayscaleFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    applyRowFilter(img, grayscaleRow, threads);
+}
+
+int thresholdLevels(const vector<string>& params) {
+    if (params.empty()) {
+        throw invalid_argument("Falta la cantidad de niveles de gris");
+    }
+    int levels = stoi(params[0]);
+    if (levels <= 0 || levels > 256) {
+        throw invalid_argument("La cantidad de niveles de gris debe estar entre 1 y 256");
+    }
+    return levels;
+}
+
+/**
+ * @brief Filtro de umbral pixel a pixel, con los parámetros ya interpretados.
+ */
+struct ThresholdOp {
+    int levels;
+    int step;
+
+    explicit ThresholdOp(const vector<string>& params) : levels(thresholdLevels(params)), step(256 / levels) {}
+
+    RGB operator()(const RGB& pixel) const {
+        uint8_t gray = static_cast<uint8_t>(luminance(pixel) / step * step);
+        return { gray, gray, gray };
+    }
+};
+
+RGB thresholdPixel(const RGB& pixel, const vector<string>& params) {
+    return ThresholdOp(params)(pixel);
 }
 
 void thresholdFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    int levels = ThresholdOp(params).levels;
+    applyRowFilter(img, [levels](uint8_t* row, int pixels) { thresholdRow(row, pixels, levels); }, threads);
 }
 
+/**
+ * @brief Box blur: cada pixel es el promedio de los pixeles del kernel centrado en él que caen
+ * dentro de la imagen.
+ * @details Con la imagen integral cada promedio cuesta lo mismo sin importar el tamaño del kernel.
+ */
+struct BoxBlurOp {
+    int radius;
+    IntegralImage integral;
+
+    explicit BoxBlurOp(const vector<string>& params) : radius(kernelRadius(params)) {}
+
+    RGB operator()(int x, int y, const RGB&) const {
+        return integral.windowMean(x, y, radius);
+    }
+};
+
 void boxBlurFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    BoxBlurOp op(params);
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+    // La tabla se calcula sobre el contenido original, así que se puede escribir encima de img
+    op.integral.build(img, threads);
+    applyPositionOp(img, op, threads);
+}
+
+void gaussianFilter(BmpImage& img, const vector<string>& params, int threads) {
+    double sigma = gaussianSigma(params);
+    gaussianBlur([&](int channel, int y) { return img.getRowData(y) + channel; }, 3, 3,
+                 img.getWidth(), img.getHeight(), sigma, threads);
+}
+
+int unsharpStrength(const vector<string>& params) {
+    if (params.size() < 2) {
+        throw invalid_argument("Falta la fuerza de la máscara");
+    }
+    return stoi(params[1]);
+}
+
+bool unsharpUsesGaussian(const vector<string>& params) {
+    if (params.size() < 3 || params[2] == "box") return false;
+    if (params[2] == "gaussian") return true;
+    throw invalid_argument("Tipo de desenfoque desconocido: " + params[2]);
+}
+
+int unsharpReach(const vector<string>& params) {
+    return unsharpUsesGaussian(params) ? gaussianReach(params) : kernelRadius(params);
+}
+
+/**
+ * @brief Promedia una fila de sumas por columna con una ventana horizontal y aplica la máscara.
+ * @param columns Suma de cada canal de cada columna sobre las filas de la ventana (BGR intercalado).
+ * @param prefix Buffer de (width + 1) * 3 sumas para las sumas prefijas de columns.
+ * @param rows Cantidad de filas sumadas en columns.
+ * @details El promedio redondea igual que IntegralImage::windowMean. En el interior de la fila todas
+ * las ventanas tienen la misma cantidad de píxeles, así que la división se reemplaza por una
+ * multiplicación por el recíproco (como en boxBlurPlanes), exacta mientras la ventana tenga menos
+ * de 2^24 píxeles; las ventanas más grandes dividen. Las sumas prefijas son de 64 bits, porque una
+ * fila de sumas por columna puede pasar de 2^32.
+ */
+static void sharpenRow(uint8_t* pixels, const uint32_t* columns, uint64_t* prefix, int width, int radius,
+                       uint32_t rows, int strength) {
+    for (int c = 0; c < 3; ++c) prefix[c] = 0;
+    for (int i = 0; i < width * 3; ++i) prefix[i + 3] = prefix[i] + columns[i];
+
+    int interiorStart = min(width, radius);
+    int interiorEnd = max(interiorStart, width - radius);
+    uint64_t count = static_cast<uint64_t>(2 * radius + 1) * rows;
+    bool useReciprocal = count < (1u << 24);
+    uint64_t reciprocal = useReciprocal ? ((uint64_t(1) << 56) + count - 1) / count : 0;
+    for (int x = 0; x < width; ++x) {
+        if (x == interiorStart && useReciprocal) {
+            for (; x < interiorEnd; ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    uint64_t sum = prefix[(x + radius + 1) * 3 + c] - prefix[(x - radius) * 3 + c] + count / 2;
+                    int blurred = static_cast<int>((sum * reciprocal) >> 56);
+                    pixels[x * 3 + c] = sharpenChannel(pixels[x * 3 + c], blurred, strength);
+                }
+            }
+            if (x >= width) break;
+        }
+        int x0 = max(0, x - radius), x1 = min(width, x + radius + 1);
+        uint64_t windowCount = static_cast<uint64_t>(x1 - x0) * rows;
+        for (int c = 0; c < 3; ++c) {
+            int blurred = static_cast<int>((prefix[x1 * 3 + c] - prefix[x0 * 3 + c] + windowCount / 2) / windowCount);
+            pixels[x * 3 + c] = sharpenChannel(pixels[x * 3 + c], blurred, strength);
+        }
+    }
+}
+
+/**
+ * @brief Máscara de desenfoque con box blur, en una sola pasada y en el lugar.
+ * @details La imagen se parte en bandas horizontales, una por tarea. Cada banda baja fila por fila
+ * manteniendo las sumas por columna de las filas de su ventana (suma la fila que entra y resta la
+ * que sale) y escribe el resultado de cada fila apenas la calcula. Las filas originales que todavía
+ * hacen falta después de escribirlas se guardan en un buffer circular de radius + 1 filas, y las
+ * filas vecinas de otras bandas se copian antes de empezar (radius de cada lado del borde). Así la
+ * memoria extra es de unas pocas filas por banda, en lugar de una copia desenfocada o una imagen
+ * integral de la imagen completa.
+ */
+static void boxUnsharpMask(BmpImage& img, const vector<string>& params, int threads) {
+    int radius = kernelRadius(params);
+    int strength = unsharpStrength(params);
+    int width = img.getWidth();
+    int height = img.getHeight();
+    if (width == 0 || height == 0) return;
+
+    // Una ventana más alta que la imagen suma las mismas filas que una de la altura de la imagen
+    int rowRadius = min(radius, height);
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    // Bandas de al menos 8 ventanas de alto, para que las copias de los bordes sean poca memoria
+    int bands = clamp(height / (8 * (2 * rowRadius + 1)), 1, max(1, threads));
+    auto bandStart = [&](int band) { return static_cast<int>(static_cast<int64_t>(band) * height / bands); };
+
+    // Filas [borde - rowRadius, borde + rowRadius) de cada borde entre bandas, antes de que se escriban
+    ScratchBuffer edges(static_cast<size_t>(bands - 1) * 2 * rowRadius * rowBytes);
+    threadPool().parallelFor(threads, 1, bands, 1, [&](int first, int last) {
+        for (int band = first; band < last; ++band) {
+            uint8_t* edge = edges.data() + static_cast<size_t>(band - 1) * 2 * rowRadius * rowBytes;
+            for (int i = 0; i < 2 * rowRadius; ++i) {
+                memcpy(edge + i * rowBytes, img.getRowData(bandStart(band) - rowRadius + i), rowBytes);
+            }
+        }
+    });
+
+    threadPool().parallelFor(threads, 0, bands, 1, [&](int first, int last) {
+        vector<uint32_t> columns(width * 3);
+        vector<uint64_t> prefix((width + 1) * 3);
+        vector<uint8_t> ring((rowRadius + 1) * rowBytes);
+        for (int band = first; band < last; ++band) {
+            int yStart = bandStart(band), yEnd = bandStart(band + 1);
+            const uint8_t* above = band > 0 ? edges.data() + static_cast<size_t>(band - 1) * 2 * rowRadius * rowBytes : nullptr;
+            const uint8_t* below = band + 1 < bands ? edges.data() + static_cast<size_t>(band) * 2 * rowRadius * rowBytes : nullptr;
+            int y = yStart;
+            // Fila original: de las bandas vecinas, del buffer circular si ya se escribió, o de img
+            auto original = [&](int row) -> const uint8_t* {
+                if (row < yStart) return above + (row - yStart + rowRadius) * rowBytes;
+                if (row >= yEnd) return below + (row - yEnd + rowRadius) * rowBytes;
+                if (row < y) return &ring[(row % (rowRadius + 1)) * rowBytes];
+                return img.getRowData(row);
+            };
+
+            int y0 = max(0, yStart - rowRadius), y1 = min(height, yStart + rowRadius + 1);
+            fill(columns.begin(), columns.end(), 0);
+            for (int row = y0; row < y1; ++row) {
+                const uint8_t* pixels = original(row);
+                for (size_t i = 0; i < rowBytes; ++i) columns[i] += pixels[i];
+            }
+            for (; y < yEnd; ++y) {
+                // Bajar la ventana una fila: entra la de abajo y sale la de arriba
+                if (y > yStart) {
+                    if (y + rowRadius < height) {
+                        const uint8_t* entering = original(y + rowRadius);
+                        for (size_t i = 0; i < rowBytes; ++i) columns[i] += entering[i];
+                        ++y1;
+                    }
+                    if (y - rowRadius - 1 >= 0) {
+                        const uint8_t* leaving = original(y - rowRadius - 1);
+                        for (size_t i = 0; i < rowBytes; ++i) columns[i] -= leaving[i];
+                        ++y0;
+                    }
+                }
+                uint8_t* pixels = img.getRowData(y);
+                memcpy(&ring[(y % (rowRadius + 1)) * rowBytes], pixels, rowBytes);
+                sharpenRow(pixels, columns.data(), prefix.data(), width, radius, y1 - y0, strength);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Máscara de desenfoque con desenfoque gaussiano: la copia desenfocada va a kernelScratch.
+ */
+static void gaussianUnsharpMask(BmpImage& img, const vector<string>& params, int threads) {
+    double sigma = gaussianSigma(params);
+    int strength = unsharpStrength(params);
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+
+    BmpImage& blurred = kernelScratchFor(img);
+    size_t rowBytes = static_cast<size_t>(img.getWidth()) * 3;
+    threadPool().parallelFor(threads, 0, img.getHeight(), rowGrain(img, 0), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            memcpy(blurred.getRowData(y), img.getRowData(y), rowBytes);
+        }
+    });
+    gaussianBlur([&](int channel, int y) { return blurred.getRowData(y) + channel; }, 3, 3,
+                 img.getWidth(), img.getHeight(), sigma, threads);
+    applyPositionOp(img, [&](int x, int y, const RGB& original) -> RGB {
+        const RGB& blur = blurred.getRow(y)[x];
+        return { sharpenChannel(original.blue, blur.blue, strength),
+                 sharpenChannel(original.green, blur.green, strength),
+                 sharpenChannel(original.red, blur.red, strength) };
+    }, threads);
 }
 
 void unsharpMaskFilter(BmpImage& img, const vector<string>& params, int threads) {
-    // Completar
+    if (unsharpUsesGaussian(params)) {
+        gaussianUnsharpMask(img, params, threads);
+        return;
+    }
+    boxUnsharpMask(img, params, threads);
+}
+
+/**
+ * @brief Umbral adaptativo: compara cada pixel con la luminancia promedio de su vecindario.
+ */
+struct AdaptiveThresholdOp {
+    int radius;
+    int offset;
+    IntegralImage integral;
+
+    explicit AdaptiveThresholdOp(const vector<string>& params)
+        : radius(kernelRadius(params)), offset(params.size() > 1 ? stoi(params[1]) : 0) {}
+
+    RGB operator()(int x, int y, const RGB& pixel) const {
+        int localMean = luminance(integral.windowMean(x, y, radius));
+        uint8_t value = luminance(pixel) > localMean - offset ? 255 : 0;
+        return { value, value, value };
+    }
+};
+
+void adaptiveThresholdFilter(BmpImage& img, const vector<string>& params, int threads) {
+    AdaptiveThresholdOp op(params);
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+    op.integral.build(img, threads);
+    applyPositionOp(img, op, threads);
+}
+
+/**
+ * @brief Pasa img a otro tamaño: el resultado se arma en una imagen nueva (con el mismo formato de
+ * archivo), que reemplaza a img. El canal alfa se reduce igual que los colores.
+ */
+static void resizeTo(BmpImage& img, pair<int, int> size, int threads) {
+    auto [width, height] = size;
+    if (width == img.getWidth() && height == img.getHeight()) return;
+    BmpImage resized;
+    resized.create(width, height, img.hasAlpha() ? 32 : 24, img.isTopDown());
+    const BmpImage& source = img;
+    resizeArea([&](int y) { return source.getRowData(y); }, img.getWidth(), img.getHeight(),
+               [&](int y) { return resized.getRowData(y); }, width, height, 3, threads);
+    if (img.hasAlpha()) {
+        resizeArea([&](int y) { return source.getAlphaRow(y); }, img.getWidth(), img.getHeight(),
+                   [&](int y) { return resized.getAlphaRow(y); }, width, height, 1, threads);
+    }
+    img = move(resized);
+}
+
+void resizeFilter(BmpImage& img, const vector<string>& params, int threads) {
+    resizeTo(img, resizeTarget(params, img.getWidth(), img.getHeight()), threads);
+}
+
+void scaleFilter(BmpImage& img, const vector<string>& params, int threads) {
+    resizeTo(img, scaleTarget(params, img.getWidth(), img.getHeight()), threads);
+}
+
+/**
+ * @brief Cuenta el histograma de img y le aplica las tablas que se arman con él.
+ */
+static void applyHistogramTables(BmpImage& img, const function<ChannelTables(const ImageHistogram&)>& makeTables,
+                                 int threads) {
+    auto row = [&](int channel, int y) { return img.getRowData(y) + channel; };
+    ImageHistogram histogram = imageHistogram(row, 3, img.getWidth(), img.getHeight(), threads);
+    applyChannelTables(row, 3, img.getWidth(), img.getHeight(), makeTables(histogram), threads);
+}
+
+void equalizeFilter(BmpImage& img, const vector<string>& params, int threads) {
+    applyHistogramTables(img, equalizeTables, threads);
+}
+
+void autolevelsFilter(BmpImage& img, const vector<string>& params, int threads) {
+    double clip = autolevelsClip(params);
+    applyHistogramTables(img, [clip](const ImageHistogram& histogram) { return autolevelsTables(histogram, clip); },
+                         threads);
 }
 
 void registerFilters() {
-    // Registrar los que van implementando
-    // registerFilter("identity", identityFilter);
-    // registerFilter("negative", negativeFilter);
-    // registerFilter("grayscale", grayscaleFilter);
-    // registerFilter("threshold", thresholdFilter);
-    // registerFilter("boxblur", boxBlurFilter);
-    // registerFilter("unsharp", unsharpMaskFilter);
-}
\ No newline at end of file
+    // Con SIMD cada filtro usa su kernel vectorial, que es más rápido que una búsqueda en tabla por
+    // canal. Sin SIMD se usan tablas, que juntan los filtros seguidos en una sola búsqueda.
+    registerFilter("identity", identityFilter, nullptr, [](PointProgram&, const vector<string>&) {});
+    registerFilter("negative", negativeFilter, nullptr, [](PointProgram& program, const vector<string>&) {
+        if (simdLevel() != SimdLevel::Scalar) {
+            program.rowKernel(negateRow);
+        } else {
+            program.map([](int, uint8_t value) { return static_cast<uint8_t>(255 - value); });
+        }
+    });
+    registerFilter("grayscale", grayscaleFilter, nullptr, [](PointProgram& program, const vector<string>&) {
+        if (simdLevel() != SimdLevel::Scalar) {
+            program.rowKernel(grayscaleRow);
+        } else {
+            program.luminance();
+        }
+    });
+    registerFilter("threshold", thresholdFilter, nullptr, [](PointProgram& program, const vector<string>& params) {
+        ThresholdOp op(params);
+        if (simdLevel() != SimdLevel::Scalar) {
+            int levels = op.levels;
+            program.rowKernel([levels](uint8_t* row, int pixels) { thresholdRow(row, pixels, levels); });
+        } else {
+            int step = op.step;
+            program.luminance();
+            program.map([step](int, uint8_t value) { return static_cast<uint8_t>(value / step * step); });
+        }
+    });
+    registerFilter("boxblur", boxBlurFilter, kernelRadius);
+    registerFilter("gaussian", gaussianFilter, gaussianReach);
+    registerFilter("unsharp", unsharpMaskFilter, unsharpReach);
+    registerFilter("adaptive", adaptiveThresholdFilter, kernelRadius);
+    registerFilter("resize", resizeFilter);
+    registerFilter("scale", scaleFilter);
+    registerWholeImageFilter("resize");
+    registerWholeImageFilter("scale");
+    // Las tablas dependen del histograma de toda la imagen, así que no se pueden aplicar por bloques
+    registerFilter("equalize", equalizeFilter);
+    registerFilter("autolevels", autolevelsFilter);
+    registerWholeImageFilter("equalize");
+    registerWholeImageFilter("autolevels");
+
+    registerPlanarFilter("identity", [](PlanarImage&, const vector<string>&, int) {});
+    registerPlanarFilter("negative", negativePlanarFilter);
+    registerPlanarFilter("grayscale", grayscalePlanarFilter);
+    registerPlanarFilter("threshold", thresholdPlanarFilter);
+    registerPlanarFilter("boxblur", boxBlurPlanarFilter);
+    registerPlanarFilter("gaussian", gaussianPlanarFilter);
+    registerPlanarFilter("unsharp", unsharpMaskPlanarFilter);
+    registerPlanarFilter("adaptive", adaptiveThresholdPlanarFilter);
+    registerPlanarFilter("equalize", equalizePlanarFilter);
+    registerPlanarFilter("autolevels", autolevelsPlanarFilter);
+}
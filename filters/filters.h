@@ -2,6 +2,11 @@
 #define FILTERS_H
 
 #include "../BMPImage.h"
+#include "../utils/threadpool.h"
+#include "point.h"
+#include "planar.h"
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <vector>
 #include <string>
@@ -15,12 +20,88 @@
  */
 using FilterFunc = function<void(BmpImage&, const vector<string>&, int threads)>;
 
+/**
+ * @brief Tipo de una función que calcula el alcance de un filtro.
+ * @details Recibe los parámetros del filtro y devuelve cuántos píxeles alrededor de cada píxel
+ * necesita leer el filtro (por ejemplo, el radio del kernel). Para los filtros pixel a pixel es 0.
+ */
+using FilterReach = function<int(const vector<string>&)>;
+
+/**
+ * @brief Tipo de una función que describe un filtro punto a punto como operaciones por fila.
+ * @details Recibe el programa acumulado y los parámetros del filtro, y compone el filtro sobre el
+ * programa (ver PointProgram). Así una corrida de filtros punto a punto se aplica con una sola pasada.
+ */
+using PointStage = function<void(PointProgram&, const vector<string>&)>;
+
 /**
  * @brief Registra un nuevo filtro en el sistema.
  * @param name Nombre del filtro.
  * @param func Función que implementa el filtro.
+ * @param reach Alcance del filtro (opcional). Si no se indica, el filtro es pixel a pixel.
+ * @param point Descripción del filtro como operaciones por fila (opcional, sólo para filtros punto a punto).
+ */
+void registerFilter(const string& name, FilterFunc func, FilterReach reach = nullptr, PointStage point = nullptr);
+
+/**
+ * @brief Compone un filtro registrado sobre un programa punto a punto, si se puede.
+ * @param program Programa acumulado.
+ * @param filterName Nombre del filtro.
+ * @param params Parámetros del filtro.
+ * @return True si el filtro se compuso, false si no es punto a punto (program no se modifica).
+ * @throws runtime_error Si el filtro no está registrado (y lo que lance el filtro con sus parámetros).
+ */
+bool compilePointStep(PointProgram& program, const string& filterName, const vector<string>& params);
+
+/**
+ * @brief Tipo de la versión sobre planos (ver PlanarImage) de un filtro.
+ */
+using PlanarFilterFunc = function<void(PlanarImage&, const vector<string>&, int threads)>;
+
+/**
+ * @brief Registra la versión sobre planos de un filtro.
+ * @param name Nombre del filtro. Debe llamarse después de registerFilter, que borra la versión
+ * sobre planos anterior.
+ * @param func Función que implementa el filtro sobre planos. Debe dar el mismo resultado que la
+ * versión intercalada.
+ */
+void registerPlanarFilter(const string& name, PlanarFilterFunc func);
+
+/**
+ * @brief Aplica la versión sobre planos de un filtro, si tiene una.
+ * @return True si se aplicó, false si el filtro no tiene versión sobre planos (img no se modifica).
+ * @throws runtime_error Si el filtro no está registrado.
+ */
+bool applyPlanarFilter(PlanarImage& img, const string& filterName, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Marca un filtro registrado como de imagen completa.
+ * @param name Nombre del filtro. Debe llamarse después de registerFilter, que borra la marca anterior.
+ * @details Son los filtros cuyo resultado no sale de un vecindario acotado de cada pixel (por
+ * ejemplo, los que cambian el tamaño de la imagen): no se pueden aplicar por bloques ni por franjas,
+ * así que los pipelines los aplican sobre la imagen entera.
  */
-void registerFilter(const string& name, FilterFunc func);
+void registerWholeImageFilter(const string& name);
+
+/**
+ * @brief Indica si un filtro registrado necesita la imagen completa (ver registerWholeImageFilter).
+ * @throws runtime_error Si el filtro no está registrado.
+ */
+bool needsWholeImage(const string& filterName);
+
+/**
+ * @brief Obtiene el alcance de un filtro registrado.
+ * @param filterName Nombre del filtro.
+ * @param params Parámetros del filtro.
+ * @return Cuántos píxeles alrededor de cada píxel lee el filtro.
+ * @throws runtime_error Si el filtro no está registrado.
+ */
+int filterReach(const string& filterName, const vector<string>& params);
+
+/**
+ * @brief Obtiene los nombres de todos los filtros registrados, ordenados alfabéticamente.
+ */
+vector<string> registeredFilters();
 
 /**
  * @brief Registra todos los filtros disponibles.
@@ -76,8 +157,9 @@ void negativeFilter(BmpImage& img, const vector<string>& params, int threads = 1
  * @param pixelFunc Función que toma un pixel y devuelve el pixel modificado.
  * @param params Parámetros del filtro. Dependen del filtro específico que se esté aplicando. No se modifican, simplemente se pasan a la función del pixel.
  * @param threads Número de threads a utilizar.
+ * @param grain Cantidad de filas por bloque de trabajo (opcional). Si es 0, se elige según el ancho de la imagen.
  */
-void applyPixelFilter(BmpImage& img, function<RGB(const RGB&, const vector<string>&)> pixelFunc, const vector<string>& params,  int threads = 1);
+void applyPixelFilter(BmpImage& img, function<RGB(const RGB&, const vector<string>&)> pixelFunc, const vector<string>& params,  int threads = 1, int grain = 0);
 
 /**
  * @brief Aplica una función basada en kernel sobre la imagen, usando múltiples hilos.
@@ -85,8 +167,144 @@ void applyPixelFilter(BmpImage& img, function<RGB(const RGB&, const vector<strin
  * @param kernelFunc Función que toma la imagen, coordenadas x, y y el tamaño del kernel, y devuelve el pixel modificado.
  * @param params Parámetros del filtro. Dependen del filtro específico que se esté aplicando. No se modifican, simplemente se pasan a la función del kernel.
  * @param threads Número de threads a utilizar.
+ * @param grain Alto en filas de cada bloque de trabajo (opcional). Si es 0, se usan bloques de 256 x 64 píxeles.
+ * @details La imagen se recorre por bloques que entran en caché. El resultado se escribe en una imagen
+ * auxiliar que después se intercambia con img, así que los buffers se reutilizan de un paso al otro.
+ */
+void applyKernelFilter(BmpImage& img, function<RGB(const BmpImage&, int, int, const vector<string>&)> kernelFunc, const vector<string>& params, int threads = 1, int grain = 0);
+
+/**
+ * @brief Lee el tamaño del kernel de los parámetros de un filtro (params[0]).
+ * @return El radio del kernel (la mitad del tamaño).
+ * @throws invalid_argument Si falta el tamaño o no es positivo.
+ */
+int kernelRadius(const vector<string>& params);
+
+/**
+ * @brief Lee la cantidad de niveles de gris de los parámetros del filtro de umbral (params[0]).
+ * @throws invalid_argument Si falta o no está entre 1 y 256.
+ */
+int thresholdLevels(const vector<string>& params);
+
+/**
+ * @brief Lee la fuerza de la máscara de desenfoque (params[1]).
+ * @throws invalid_argument Si falta.
+ */
+int unsharpStrength(const vector<string>& params);
+
+/**
+ * @brief Indica si la máscara de desenfoque usa un desenfoque gaussiano (params[2] = "gaussian")
+ * en lugar del box blur (params[2] = "box" u omitido).
+ * @throws invalid_argument Si params[2] no es ninguno de los dos.
+ */
+bool unsharpUsesGaussian(const vector<string>& params);
+
+/**
+ * @brief Alcance de la máscara de desenfoque: el radio del kernel o, con el desenfoque gaussiano,
+ * el de las pasadas que lo aproximan.
  */
-void applyKernelFilter(BmpImage& img, function<RGB(const BmpImage&, int, int, const vector<string>&)> kernelFunc, const vector<string>& params, int threads = 1);
+int unsharpReach(const vector<string>& params);
+
+/**
+ * @brief Elige cuántas filas procesar por bloque de trabajo.
+ * @param grain Tamaño pedido. Si es 0, se apunta a bloques de unos 16K pixeles: suficiente trabajo
+ * para amortizar el reparto, y lo bastante chico para balancear entre hilos.
+ */
+int rowGrain(const BmpImage& img, int grain);
+
+/**
+ * @brief Obtiene la imagen auxiliar de los filtros con kernel (una por hilo), con el tamaño de img.
+ */
+BmpImage& kernelScratchFor(const BmpImage& img);
+
+// Tamaño de los bloques de los filtros con kernel: 256 x 64 píxeles son 48 KB, que junto con el halo
+// que lee el kernel entran en la caché L2, así que cada fila de origen se lee de memoria una sola vez.
+const int KERNEL_TILE_WIDTH = 256;
+const int KERNEL_TILE_HEIGHT = 64;
+
+/**
+ * @brief Versión de applyPixelFilter para operaciones conocidas en tiempo de compilación.
+ * @tparam PixelOp Tipo con `RGB operator()(const RGB& pixel) const`. Los parámetros se interpretan
+ * una sola vez al construirlo, no en cada pixel.
+ * @details La operación se llama directamente (sin pasar por std::function), así que el compilador
+ * puede inlinearla dentro del bucle de cada fila.
+ */
+template <typename PixelOp>
+void applyPixelOp(BmpImage& img, const PixelOp& op, int threads = 1, int grain = 0) {
+    threadPool().parallelFor(threads, 0, img.getHeight(), rowGrain(img, grain), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            for (RGB& pixel : img.getRow(y)) {
+                pixel = op(pixel);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Recorre las filas [0, height) en paralelo acumulando un resultado (histograma, sumas,
+ * mínimos y máximos) sin locks.
+ * @tparam Partial Resultado parcial. Se construye vacío (el neutro de merge) y es movible.
+ * @param height Cantidad de filas.
+ * @param grain Cantidad de filas por bloque de trabajo (mayor que cero).
+ * @param threads Número de threads a utilizar.
+ * @param block Función `void(Partial&, int yStart, int yEnd)` que acumula las filas [yStart, yEnd).
+ * @param merge Función `void(Partial&, const Partial&)` que suma un parcial a otro.
+ * @details Cada hilo acumula en su propio parcial (en su propia línea de caché, así los hilos no se
+ * pisan) y toma bloques de un contador compartido hasta que se acaban, así que un hilo demorado no
+ * retrasa a los demás. Al final los parciales se combinan en el hilo que llama: son tantos como
+ * hilos, no como bloques.
+ */
+template <typename Partial, typename BlockOp, typename MergeOp>
+Partial reduceRows(int height, int grain, int threads, const BlockOp& block, const MergeOp& merge) {
+    struct alignas(64) Slot {
+        Partial value;
+    };
+    int blocks = (height + grain - 1) / grain;
+    int used = clamp(min(threads, blocks), 1, threadPool().size());
+    vector<Slot> slots(used);
+    atomic<int> next{0};
+    threadPool().run(used, [&](int id, int) {
+        for (int b = next++; b < blocks; b = next++) {
+            block(slots[id].value, b * grain, min(height, (b + 1) * grain));
+        }
+    });
+    for (int i = 1; i < used; ++i) merge(slots[0].value, slots[i].value);
+    return move(slots[0].value);
+}
+
+/**
+ * @brief Versión de applyKernelFilter para operaciones conocidas en tiempo de compilación.
+ * @tparam KernelOp Tipo con `RGB operator()(const BmpImage& source, int x, int y) const`.
+ */
+template <typename KernelOp>
+void applyKernelOp(BmpImage& img, const KernelOp& op, int threads = 1, int grain = 0) {
+    // El kernel lee de img y escribe en la imagen auxiliar, para no mezclar pixeles ya filtrados con
+    // los originales. Al final se intercambian los buffers: no se copia ni se reserva nada por paso.
+    int width = img.getWidth();
+    int height = img.getHeight();
+    if (width == 0 || height == 0) return;
+    BmpImage& target = kernelScratchFor(img);
+
+    int tileHeight = grain > 0 ? grain : KERNEL_TILE_HEIGHT;
+    int tilesX = (width + KERNEL_TILE_WIDTH - 1) / KERNEL_TILE_WIDTH;
+    int tilesY = (height + tileHeight - 1) / tileHeight;
+    const BmpImage& source = img;
+    threadPool().parallelFor(threads, 0, tilesX * tilesY, 1, [&](int tileStart, int tileEnd) {
+        for (int tile = tileStart; tile < tileEnd; ++tile) {
+            int xStart = (tile % tilesX) * KERNEL_TILE_WIDTH;
+            int yStart = (tile / tilesX) * tileHeight;
+            int xEnd = min(width, xStart + KERNEL_TILE_WIDTH);
+            int yEnd = min(height, yStart + tileHeight);
+            for (int y = yStart; y < yEnd; ++y) {
+                span<RGB> row = target.getRow(y);
+                for (int x = xStart; x < xEnd; ++x) {
+                    row[x] = op(source, x, y);
+                }
+            }
+        }
+    });
+    img.swapPixels(target);
+}
 
 /**
  * @brief Filtro de umbral (threshold filter).
@@ -104,14 +322,78 @@ RGB thresholdPixel(const RGB& pixel, const vector<string>& params);
  */
 void boxBlurFilter(BmpImage& img, const vector<string>& params, int threads = 1);
 
+/**
+ * @brief Filtro de desenfoque gaussiano.
+ * @param img Imagen a la que se le aplicará el filtro.
+ * @param params Parámetros del filtro (params[0] = sigma, puede tener decimales).
+ * @param threads Número de threads a utilizar (opcional).
+ * @details Se aproxima con tres box blurs por dirección (ver gaussianBlur), así que el tiempo no
+ * depende de sigma.
+ */
+void gaussianFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
 /**
  * @brief Filtro de máscara de desenfoque (unsharp mask).
  * @param img Imagen a la que se le aplicará el filtro.
- * @param params Parámetros del filtro (params[0] = tamaño del kernel, params[1] = fuerza de la máscara).
+ * @param params Parámetros del filtro (params[0] = tamaño del kernel, params[1] = fuerza de la máscara,
+ * params[2] = tipo de desenfoque, opcional: "box" o "gaussian"; con "gaussian", params[0] es el sigma).
  * @param threads Número de threads a utilizar (opcional).
  */
 void unsharpMaskFilter(BmpImage& img, const vector<string>& params, int threads = 1);
 
+/**
+ * @brief Filtro de umbral adaptativo: cada pixel se compara con el promedio de su vecindario.
+ * @param img Imagen a la que se le aplicará el filtro.
+ * @param params Parámetros del filtro (params[0] = tamaño del kernel, params[1] = desplazamiento del umbral, opcional).
+ * @param threads Número de threads a utilizar (opcional).
+ * @details Un pixel queda blanco si su luminancia es mayor que la luminancia promedio del kernel
+ * menos el desplazamiento, y negro en caso contrario.
+ */
+void adaptiveThresholdFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Filtro que cambia el tamaño de la imagen promediando áreas (ver resizeArea).
+ * @param img Imagen a la que se le aplicará el filtro. Queda con el tamaño nuevo (y sus headers
+ * actualizados).
+ * @param params Parámetros del filtro (params[0] = ancho, params[1] = alto, opcional: si falta o es
+ * 0 se mantiene la proporción).
+ * @param threads Número de threads a utilizar (opcional).
+ * @note Es un filtro de imagen completa (ver registerWholeImageFilter). Puesto al principio de un
+ * pipeline, los pasos siguientes trabajan sobre la imagen reducida.
+ */
+void resizeFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Filtro que escala la imagen por un factor, promediando áreas como resizeFilter.
+ * @param img Imagen a la que se le aplicará el filtro.
+ * @param params Parámetros del filtro (params[0] = factor, puede tener decimales; 0.5 reduce a la mitad).
+ * @param threads Número de threads a utilizar (opcional).
+ */
+void scaleFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Filtro de ecualización: reparte los valores de cada canal de forma pareja en [0, 255]
+ * según su histograma (ver equalizeTables).
+ * @details Hace una pasada que cuenta el histograma (en paralelo, ver imageHistogram) y otra que
+ * aplica las tablas. Necesita la imagen completa.
+ */
+void equalizeFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Filtro de niveles automáticos: estira cada canal para que vaya de 0 a 255.
+ * @param params params[0] (opcional) = porcentaje de píxeles de cada extremo que se ignoran al buscar
+ * el mínimo y el máximo de cada canal (0 por defecto, ver autolevelsTables).
+ * @details Como equalizeFilter, es una pasada de histograma y una de tablas.
+ */
+void autolevelsFilter(BmpImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Libera las imágenes auxiliares que los filtros reutilizan entre pasos (también las de
+ * los filtros sobre planos).
+ * @details Conviene llamarla al terminar un pipeline. Libera sólo las del hilo que la llama.
+ */
+void releaseFilterBuffers();
+
 /* ----------------- AGREGAR ACÁ ↓↓↓ TODAS LAS DECLARACIONES DE FUNCIONES ----------------- */
 
 #endif // FILTERS_H
\ No newline at end of file
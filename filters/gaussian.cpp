@@ -0,0 +1,185 @@
+#include "gaussian.h"
+#include "../utils/bufferpool.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+double gaussianSigma(const vector<string>& params) {
+    if (params.empty()) {
+        throw invalid_argument("Falta el sigma del desenfoque");
+    }
+    double sigma = stod(params[0]);
+    if (!(sigma > 0) || !isfinite(sigma)) {
+        throw invalid_argument("El sigma del desenfoque debe ser positivo");
+    }
+    return sigma;
+}
+
+array<int, 3> gaussianBoxRadii(double sigma) {
+    const int passes = 3;
+    double variance = sigma * sigma;
+    // Ancho ideal si las tres pasadas fueran iguales, redondeado al impar de abajo
+    int lower = static_cast<int>(floor(sqrt(12 * variance / passes + 1)));
+    if (lower % 2 == 0) --lower;
+    int upper = lower + 2;
+    // Cuántas pasadas usan el ancho menor para que la varianza total se acerque más a sigma²
+    double ideal = (12 * variance - passes * lower * lower - 4.0 * passes * lower - 3 * passes) / (-4.0 * lower - 4);
+    int smaller = clamp(static_cast<int>(lround(ideal)), 0, passes);
+    array<int, 3> radii;
+    for (int i = 0; i < passes; ++i) {
+        radii[i] = ((i < smaller ? lower : upper) - 1) / 2;
+    }
+    return radii;
+}
+
+int gaussianReach(const vector<string>& params) {
+    array<int, 3> radii = gaussianBoxRadii(gaussianSigma(params));
+    return radii[0] + radii[1] + radii[2];
+}
+
+/**
+ * @brief Bits fraccionarios de los valores intermedios (punto fijo: valor del canal * 64).
+ * @details Las sumas deslizantes son enteras, así que son exactas y no acumulan error a lo largo de
+ * la fila, y entran en 32 bits mientras las filas y las columnas tengan menos de 2^31 / (255 * 64)
+ * píxeles (unos 131 mil).
+ */
+static const int GAUSSIAN_FRACTION_BITS = 6;
+static const int GAUSSIAN_MAX_LENGTH = INT32_MAX / (255 << GAUSSIAN_FRACTION_BITS);
+
+/**
+ * @brief Una pasada de box blur sobre `lanes` secuencias intercaladas de `length` valores.
+ * @details in[i * lanes + k] es el valor i de la secuencia k. Cada secuencia lleva su suma
+ * deslizante, así que el bucle interno recorre las secuencias y el compilador lo puede vectorizar.
+ * Los punteros son restrict para que el compilador sepa que las sumas no se pisan con los valores.
+ * El promedio se calcula multiplicando por el inverso de la cantidad de valores de la ventana, que
+ * sólo cambia cerca de los bordes.
+ * @tparam LaneCount Cantidad de secuencias conocida al compilar (0 si se usa runtimeLanes), para que con
+ * una sola secuencia o con bloques completos no quede un bucle de largo variable por valor.
+ */
+template <int LaneCount>
+static void boxPass(const int32_t* __restrict in, int32_t* __restrict out, int length, int runtimeLanes, int radius,
+                    int32_t* __restrict sums) {
+    const int lanes = LaneCount > 0 ? LaneCount : runtimeLanes;
+    if (radius == 0) {
+        copy(in, in + static_cast<size_t>(length) * lanes, out);
+        return;
+    }
+    auto add = [&](int i) {
+        const int32_t* values = in + static_cast<size_t>(i) * lanes;
+        for (int k = 0; k < lanes; ++k) sums[k] += values[k];
+    };
+    auto remove = [&](int i) {
+        const int32_t* values = in + static_cast<size_t>(i) * lanes;
+        for (int k = 0; k < lanes; ++k) sums[k] -= values[k];
+    };
+    auto average = [&](int i, float inverse) {
+        int32_t* target = out + static_cast<size_t>(i) * lanes;
+        for (int k = 0; k < lanes; ++k) target[k] = static_cast<int32_t>(sums[k] * inverse + 0.5f);
+    };
+
+    fill(sums, sums + lanes, 0);
+    for (int i = 0; i < min(length, radius); ++i) add(i);
+    int interiorStart = min(radius, length);
+    int interiorEnd = max(interiorStart, length - radius);
+    // Borde izquierdo: la ventana todavía no llega a radius valores hacia atrás
+    for (int i = 0; i < interiorStart; ++i) {
+        if (i + radius < length) add(i + radius);
+        average(i, 1.0f / (min(length - 1, i + radius) + 1));
+    }
+    // Interior: entra el valor i + radius y, después de promediar, sale el valor i - radius
+    float interiorInverse = 1.0f / (2 * radius + 1);
+    for (int i = interiorStart; i < interiorEnd; ++i) {
+        add(i + radius);
+        average(i, interiorInverse);
+        remove(i - radius);
+    }
+    // Borde derecho: ya no entran valores
+    for (int i = interiorEnd; i < length; ++i) {
+        average(i, 1.0f / (length - max(0, i - radius)));
+        if (i - radius >= 0) remove(i - radius);
+    }
+}
+
+/**
+ * @brief Aplica las tres pasadas alternando entre dos buffers. El resultado queda en `a`.
+ */
+template <int LaneCount>
+static void boxPasses(int32_t*& a, int32_t*& b, int length, int lanes, const array<int, 3>& radii, int32_t* sums) {
+    for (int radius : radii) {
+        boxPass<LaneCount>(a, b, length, lanes, radius, sums);
+        swap(a, b);
+    }
+}
+
+static inline int32_t toFixed(uint8_t value) {
+    return value << GAUSSIAN_FRACTION_BITS;
+}
+
+static inline uint8_t fromFixed(int32_t value) {
+    return static_cast<uint8_t>(min(255, (value + (1 << (GAUSSIAN_FRACTION_BITS - 1))) >> GAUSSIAN_FRACTION_BITS));
+}
+
+/**
+ * @brief Columnas por bloque de la pasada vertical: 64 valores por fila del buffer (256 bytes).
+ */
+static const int GAUSSIAN_COLUMN_BLOCK = 64;
+
+void gaussianBlur(const function<uint8_t*(int channel, int y)>& row, int channels, int pixelStep,
+                  int width, int height, double sigma, int threads) {
+    if (width == 0 || height == 0) return;
+    array<int, 3> radii = gaussianBoxRadii(sigma);
+    if (radii[0] + radii[1] + radii[2] == 0) return;
+    if (width > GAUSSIAN_MAX_LENGTH || height > GAUSSIAN_MAX_LENGTH) {
+        throw length_error("La imagen es demasiado grande para el desenfoque gaussiano");
+    }
+
+    // Pasada horizontal: cada fila de cada canal se copia a un buffer, se desenfoca y se vuelve a escribir
+    threadPool().parallelFor(threads, 0, height, max(1, 16384 / width), [&](int yStart, int yEnd) {
+        vector<int32_t> rows(2 * width);
+        int32_t* a = rows.data();
+        int32_t* b = a + width;
+        int32_t sums[1];
+        for (int y = yStart; y < yEnd; ++y) {
+            for (int c = 0; c < channels; ++c) {
+                uint8_t* pixels = row(c, y);
+                for (int x = 0; x < width; ++x) a[x] = toFixed(pixels[x * pixelStep]);
+                boxPasses<1>(a, b, width, 1, radii, sums);
+                for (int x = 0; x < width; ++x) pixels[x * pixelStep] = fromFixed(a[x]);
+            }
+        }
+    });
+
+    // Pasada vertical: por bloques de columnas, que se desenfocan juntas como secuencias intercaladas
+    int blocks = (width + GAUSSIAN_COLUMN_BLOCK - 1) / GAUSSIAN_COLUMN_BLOCK;
+    threadPool().parallelFor(threads, 0, blocks, 1, [&](int blockStart, int blockEnd) {
+        size_t size = static_cast<size_t>(height) * GAUSSIAN_COLUMN_BLOCK;
+        // Las columnas de un bloque ocupan 512 bytes por fila de la imagen: salen del pool
+        ScratchBuffer buffers(2 * size * sizeof(int32_t));
+        int32_t* a = buffers.as<int32_t>();
+        int32_t* b = a + size;
+        int32_t sums[GAUSSIAN_COLUMN_BLOCK];
+        for (int block = blockStart; block < blockEnd; ++block) {
+            int xStart = block * GAUSSIAN_COLUMN_BLOCK;
+            int lanes = min(GAUSSIAN_COLUMN_BLOCK, width - xStart);
+            for (int c = 0; c < channels; ++c) {
+                for (int y = 0; y < height; ++y) {
+                    const uint8_t* pixels = row(c, y) + xStart * pixelStep;
+                    int32_t* values = a + static_cast<size_t>(y) * lanes;
+                    for (int k = 0; k < lanes; ++k) values[k] = toFixed(pixels[k * pixelStep]);
+                }
+                if (lanes == GAUSSIAN_COLUMN_BLOCK) {
+                    boxPasses<GAUSSIAN_COLUMN_BLOCK>(a, b, height, lanes, radii, sums);
+                } else {
+                    boxPasses<0>(a, b, height, lanes, radii, sums);
+                }
+                for (int y = 0; y < height; ++y) {
+                    uint8_t* pixels = row(c, y) + xStart * pixelStep;
+                    const int32_t* values = a + static_cast<size_t>(y) * lanes;
+                    for (int k = 0; k < lanes; ++k) pixels[k * pixelStep] = fromFixed(values[k]);
+                }
+            }
+        }
+    });
+}
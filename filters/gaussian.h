@@ -0,0 +1,49 @@
+#ifndef GAUSSIAN_H
+#define GAUSSIAN_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Interpreta el sigma de un desenfoque gaussiano (params[0]).
+ * @throws invalid_argument si falta o no es positivo.
+ */
+double gaussianSigma(const vector<string>& params);
+
+/**
+ * @brief Radios de las tres pasadas de box blur que aproximan una gaussiana de desvío sigma.
+ * @details Las pasadas tienen anchos impares consecutivos (w y w + 2) elegidos para que la varianza
+ * total sea lo más cercana posible a sigma² (Kovesi, "Fast almost-Gaussian filtering").
+ */
+array<int, 3> gaussianBoxRadii(double sigma);
+
+/**
+ * @brief Alcance del desenfoque gaussiano (params[0] = sigma): la suma de los radios de las pasadas.
+ */
+int gaussianReach(const vector<string>& params);
+
+/**
+ * @brief Desenfoque gaussiano aproximado, en el lugar, de canales de bytes.
+ * @param row Devuelve el primer byte de la fila y (contando desde cualquier extremo) del canal dado.
+ * @param channels Cantidad de canales.
+ * @param pixelStep Distancia en bytes entre dos píxeles seguidos de un canal (3 en BGR intercalado,
+ * 1 en planos).
+ * @param width Ancho en píxeles.
+ * @param height Alto en píxeles.
+ * @param sigma Desvío de la gaussiana.
+ * @param threads Número de threads a utilizar.
+ * @details Hace tres box blurs horizontales (en paralelo por filas) y tres verticales (en paralelo
+ * por bloques de columnas), cada uno con una suma deslizante, así que el costo por pixel no depende
+ * de sigma. Los valores intermedios están en punto fijo y se redondean a bytes una vez por
+ * dirección. En los bordes cada ventana promedia sólo los píxeles que caen dentro de la imagen,
+ * como boxBlurFilter.
+ */
+void gaussianBlur(const function<uint8_t*(int channel, int y)>& row, int channels, int pixelStep,
+                  int width, int height, double sigma, int threads);
+
+#endif // GAUSSIAN_H
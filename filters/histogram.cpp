@@ -0,0 +1,156 @@
+#include "histogram.h"
+#include "filters.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void ImageHistogram::merge(const ImageHistogram& other) {
+    for (int c = 0; c < 3; ++c) {
+        ChannelStats& target = channels[c];
+        const ChannelStats& source = other.channels[c];
+        for (int v = 0; v < 256; ++v) target.counts[v] += source.counts[v];
+        target.sum += source.sum;
+        target.minimum = min(target.minimum, source.minimum);
+        target.maximum = max(target.maximum, source.maximum);
+    }
+    pixels += other.pixels;
+}
+
+/**
+ * @brief Bancos de contadores de un canal: el pixel x se cuenta en el banco x % 4.
+ */
+using CountBanks = array<array<uint32_t, 256>, 4>;
+
+/**
+ * @brief Cuenta los valores de un canal de una fila en los bancos.
+ * @tparam Step Distancia entre píxeles seguidos, conocida al compilar para que el bucle no multiplique.
+ */
+template <int Step>
+static void countRow(const uint8_t* data, int pixels, CountBanks& banks) {
+    int x = 0;
+    for (; x + 4 <= pixels; x += 4) {
+        ++banks[0][data[x * Step]];
+        ++banks[1][data[(x + 1) * Step]];
+        ++banks[2][data[(x + 2) * Step]];
+        ++banks[3][data[(x + 3) * Step]];
+    }
+    for (; x < pixels; ++x) ++banks[0][data[x * Step]];
+}
+
+/**
+ * @brief Bloques de unos 64K píxeles: los contadores de 32 bits no pueden desbordar, y vaciar y volcar
+ * los bancos (1024 contadores por canal) es poco al lado de contar el bloque.
+ */
+static int histogramGrain(int width) {
+    return max(1, 65536 / max(1, width));
+}
+
+ImageHistogram imageHistogram(const function<const uint8_t*(int channel, int y)>& row, int pixelStep,
+                              int width, int height, int threads) {
+    if (width == 0 || height == 0) return ImageHistogram();
+    auto block = [&](ImageHistogram& partial, int yStart, int yEnd) {
+        CountBanks banks;
+        for (int c = 0; c < 3; ++c) {
+            for (auto& bank : banks) bank.fill(0);
+            for (int y = yStart; y < yEnd; ++y) {
+                if (pixelStep == 3) {
+                    countRow<3>(row(c, y), width, banks);
+                } else if (pixelStep == 1) {
+                    countRow<1>(row(c, y), width, banks);
+                } else {
+                    const uint8_t* data = row(c, y);
+                    for (int x = 0; x < width; ++x) ++banks[0][data[x * pixelStep]];
+                }
+            }
+            ChannelStats& stats = partial.channels[c];
+            for (int v = 0; v < 256; ++v) {
+                uint64_t count = uint64_t(banks[0][v]) + banks[1][v] + banks[2][v] + banks[3][v];
+                if (count == 0) continue;
+                stats.counts[v] += count;
+                stats.sum += count * v;
+                stats.minimum = min<uint8_t>(stats.minimum, v);
+                stats.maximum = max<uint8_t>(stats.maximum, v);
+            }
+        }
+        partial.pixels += static_cast<uint64_t>(yEnd - yStart) * width;
+    };
+    return reduceRows<ImageHistogram>(height, histogramGrain(width), threads, block,
+                                      [](ImageHistogram& a, const ImageHistogram& b) { a.merge(b); });
+}
+
+void applyChannelTables(const function<uint8_t*(int channel, int y)>& row, int pixelStep, int width, int height,
+                        const ChannelTables& tables, int threads) {
+    threadPool().parallelFor(threads, 0, height, max(1, 16384 / max(1, width)), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            for (int c = 0; c < 3; ++c) {
+                uint8_t* data = row(c, y);
+                const array<uint8_t, 256>& table = tables[c];
+                for (int x = 0; x < width; ++x) data[x * pixelStep] = table[data[x * pixelStep]];
+            }
+        }
+    });
+}
+
+/**
+ * @brief Tabla que deja cada valor igual.
+ */
+static array<uint8_t, 256> identityTable() {
+    array<uint8_t, 256> table;
+    for (int v = 0; v < 256; ++v) table[v] = static_cast<uint8_t>(v);
+    return table;
+}
+
+ChannelTables equalizeTables(const ImageHistogram& histogram) {
+    ChannelTables tables;
+    for (int c = 0; c < 3; ++c) {
+        const ChannelStats& stats = histogram.channels[c];
+        uint64_t first = stats.counts[stats.minimum];
+        uint64_t range = histogram.pixels - first;
+        if (histogram.pixels == 0 || range == 0) {
+            tables[c] = identityTable();
+            continue;
+        }
+        uint64_t cumulative = 0;
+        for (int v = 0; v < 256; ++v) {
+            cumulative += stats.counts[v];
+            uint64_t above = cumulative > first ? cumulative - first : 0;
+            // Redondeo al más cercano en enteros: (2 * 255 * above + range) / (2 * range)
+            tables[c][v] = static_cast<uint8_t>((510 * above + range) / (2 * range));
+        }
+    }
+    return tables;
+}
+
+double autolevelsClip(const vector<string>& params) {
+    if (params.empty()) return 0;
+    double clip = stod(params[0]);
+    if (!(clip >= 0 && clip < 50)) {
+        throw invalid_argument("El recorte de los niveles automáticos debe estar entre 0 y 50");
+    }
+    return clip;
+}
+
+ChannelTables autolevelsTables(const ImageHistogram& histogram, double clip) {
+    uint64_t ignored = static_cast<uint64_t>(floor(histogram.pixels * clip / 100));
+    ChannelTables tables;
+    for (int c = 0; c < 3; ++c) {
+        const ChannelStats& stats = histogram.channels[c];
+        int low = stats.minimum, high = stats.maximum;
+        if (ignored > 0) {
+            uint64_t below = 0;
+            for (low = 0; low < 255 && below + stats.counts[low] <= ignored; ++low) below += stats.counts[low];
+            uint64_t above = 0;
+            for (high = 255; high > 0 && above + stats.counts[high] <= ignored; --high) above += stats.counts[high];
+        }
+        if (high <= low) {
+            tables[c] = identityTable();
+            continue;
+        }
+        for (int v = 0; v < 256; ++v) {
+            int stretched = ((v - low) * 510 + (high - low)) / (2 * (high - low));
+            tables[c][v] = static_cast<uint8_t>(clamp(stretched, 0, 255));
+        }
+    }
+    return tables;
+}
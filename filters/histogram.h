@@ -0,0 +1,89 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Histograma de un canal y las estadísticas que se acumulan junto con él.
+ */
+struct ChannelStats {
+    array<uint64_t, 256> counts{}; ///< Cantidad de píxeles con cada valor.
+    uint64_t sum = 0;              ///< Suma de los valores.
+    uint8_t minimum = 255;         ///< Menor valor presente (255 si no hay píxeles).
+    uint8_t maximum = 0;           ///< Mayor valor presente (0 si no hay píxeles).
+};
+
+/**
+ * @brief Histogramas y estadísticas de los tres canales de una imagen (0 = azul, 1 = verde, 2 = rojo).
+ */
+struct ImageHistogram {
+    array<ChannelStats, 3> channels;
+    uint64_t pixels = 0;
+
+    /**
+     * @brief Suma al histograma el de otra parte de la imagen.
+     */
+    void merge(const ImageHistogram& other);
+};
+
+/**
+ * @brief Tablas de 256 entradas por canal: salida[c] = tables[c][entrada[c]].
+ */
+using ChannelTables = array<array<uint8_t, 256>, 3>;
+
+/**
+ * @brief Cuenta el histograma de cada canal de una imagen de canales de bytes.
+ * @param row Devuelve el primer byte de la fila y (contando desde cualquier extremo) del canal dado.
+ * @param pixelStep Distancia en bytes entre dos píxeles seguidos de un canal (3 en BGR intercalado,
+ * 1 en planos).
+ * @param width Ancho en píxeles.
+ * @param height Alto en píxeles.
+ * @param threads Número de threads a utilizar.
+ * @details Es una sola pasada por la imagen repartida con reduceRows: cada hilo cuenta en su propio
+ * histograma y al final se suman. Dentro de cada bloque de filas se cuenta en contadores de 32 bits
+ * repartidos en cuatro bancos (píxeles seguidos van a bancos distintos), así una zona de un solo color
+ * no encadena incrementos sobre el mismo contador; los bancos se vuelcan al histograma del hilo, junto
+ * con la suma, el mínimo y el máximo, al terminar el bloque.
+ */
+ImageHistogram imageHistogram(const function<const uint8_t*(int channel, int y)>& row, int pixelStep,
+                              int width, int height, int threads);
+
+/**
+ * @brief Aplica una tabla por canal, en el lugar, a una imagen de canales de bytes.
+ * @param row Como en imageHistogram, pero con acceso de escritura.
+ * @details Las filas se reparten entre los threads.
+ */
+void applyChannelTables(const function<uint8_t*(int channel, int y)>& row, int pixelStep, int width, int height,
+                        const ChannelTables& tables, int threads);
+
+/**
+ * @brief Tablas de ecualización de histograma.
+ * @details Cada valor v pasa a round(255 * (cdf(v) - cdf(mín)) / (píxeles - cdf(mín))), donde cdf(v)
+ * es la cantidad de píxeles del canal con valor <= v. Así el menor valor presente queda en 0, el mayor
+ * en 255, y los intermedios se separan más donde hay más píxeles. Un canal de un solo valor no cambia.
+ */
+ChannelTables equalizeTables(const ImageHistogram& histogram);
+
+/**
+ * @brief Lee el porcentaje de recorte de los niveles automáticos (params[0], 0 si falta).
+ * @throws invalid_argument Si no está en [0, 50).
+ */
+double autolevelsClip(const vector<string>& params);
+
+/**
+ * @brief Tablas de niveles automáticos (estiramiento de contraste).
+ * @param clip Porcentaje de píxeles de cada extremo del canal que se ignoran.
+ * @details Por cada canal se busca el menor valor bajo el que queda a lo sumo clip% de los píxeles y
+ * el mayor sobre el que queda a lo sumo clip% (con clip = 0, el mínimo y el máximo del canal), y ese
+ * rango se estira linealmente a [0, 255]; lo que queda afuera se satura. Un canal en el que los dos
+ * extremos coinciden no cambia.
+ */
+ChannelTables autolevelsTables(const ImageHistogram& histogram, double clip);
+
+#endif // HISTOGRAM_H
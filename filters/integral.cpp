@@ -0,0 +1,64 @@
+#include "integral.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+
+void IntegralImage::build(const BmpImage& img, int threads) {
+    width = img.getWidth();
+    height = img.getHeight();
+    wide = static_cast<uint64_t>(width) * height >= (uint64_t(1) << 24);
+    if (wide) {
+        fillTable<uint64_t>(img, threads);
+    } else {
+        fillTable<uint32_t>(img, threads);
+    }
+}
+
+template <typename Sum>
+void IntegralImage::fillTable(const BmpImage& img, int threads) {
+    size_t rowSize = static_cast<size_t>(width + 1) * 3;
+    table.resize(rowSize * (height + 1) * sizeof(Sum));
+    Sum* sums = table.as<Sum>();
+    // La fila 0 y la columna 0 quedan en cero
+    fill(sums, sums + rowSize, 0);
+
+    // Pasada 1: sumas prefijas de cada fila
+    threadPool().parallelFor(threads, 0, height, max(1, 16384 / max(1, width)), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            span<const RGB> pixels = img.getRow(y);
+            Sum* row = &sums[(y + 1) * rowSize];
+            row[0] = row[1] = row[2] = 0;
+            Sum blue = 0, green = 0, red = 0;
+            for (int x = 0; x < width; ++x) {
+                const RGB& pixel = pixels[x];
+                blue += pixel.blue;
+                green += pixel.green;
+                red += pixel.red;
+                row[(x + 1) * 3] = blue;
+                row[(x + 1) * 3 + 1] = green;
+                row[(x + 1) * 3 + 2] = red;
+            }
+        }
+    });
+
+    // Pasada 2: acumular las filas hacia abajo, por bloques de columnas
+    threadPool().parallelFor(threads, 1, width + 1, 64, [&](int xStart, int xEnd) {
+        for (int y = 2; y <= height; ++y) {
+            const Sum* above = &sums[(y - 1) * rowSize + xStart * 3];
+            Sum* row = &sums[y * rowSize + xStart * 3];
+            for (int c = 0; c < (xEnd - xStart) * 3; ++c) {
+                row[c] += above[c];
+            }
+        }
+    });
+}
+
+RGB IntegralImage::windowMean(int x, int y, int radius) const {
+    int x0 = max(0, x - radius), x1 = min(width, x + radius + 1);
+    int y0 = max(0, y - radius), y1 = min(height, y + radius + 1);
+    uint64_t sums[3];
+    sum(x0, y0, x1, y1, sums);
+    uint64_t count = static_cast<uint64_t>(x1 - x0) * (y1 - y0);
+    return { static_cast<uint8_t>((sums[0] + count / 2) / count),
+             static_cast<uint8_t>((sums[1] + count / 2) / count),
+             static_cast<uint8_t>((sums[2] + count / 2) / count) };
+}
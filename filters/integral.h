@@ -0,0 +1,74 @@
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include "../BMPImage.h"
+#include "../utils/bufferpool.h"
+#include <vector>
+
+/**
+ * @brief Imagen integral (summed-area table) de una BmpImage.
+ * @details Guarda, para cada canal, la suma de todos los píxeles por encima y a la izquierda de cada
+ * posición. Con eso la suma de cualquier rectángulo se obtiene con 4 lecturas, sin importar su tamaño.
+ * Las sumas son de 32 bits y pueden desbordar, pero como se usa aritmética modular la suma de un
+ * rectángulo es exacta siempre que el rectángulo tenga menos de 2^24 píxeles. Las imágenes de 2^24
+ * píxeles o más, donde una ventana puede llegar a ese tamaño, usan sumas de 64 bits.
+ */
+class IntegralImage {
+public:
+    /**
+     * @brief Construye la tabla a partir de una imagen.
+     * @param img Imagen de origen.
+     * @param threads Número de threads a utilizar.
+     * @details Hace un prefix scan en dos pasadas paralelas: primero a lo largo de cada fila y
+     * después a lo largo de cada columna.
+     */
+    void build(const BmpImage& img, int threads);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /**
+     * @brief Suma los píxeles del rectángulo [x0, x1) x [y0, y1).
+     * @param sums Arreglo donde se guardan las sumas de azul, verde y rojo (en ese orden).
+     */
+    void sum(int x0, int y0, int x1, int y1, uint64_t sums[3]) const {
+        if (wide) {
+            rectangleSum<uint64_t>(x0, y0, x1, y1, sums);
+        } else {
+            rectangleSum<uint32_t>(x0, y0, x1, y1, sums);
+        }
+    }
+
+    /**
+     * @brief Promedio de los píxeles del kernel de radio `radius` centrado en (x, y).
+     * @details Sólo se promedian los píxeles que caen dentro de la imagen (igual que boxBlurFilter).
+     */
+    RGB windowMean(int x, int y, int radius) const;
+
+private:
+    template <typename Sum>
+    void fillTable(const BmpImage& img, int threads);
+
+    template <typename Sum>
+    const Sum* at(int x, int y) const {
+        return table.as<Sum>() + (static_cast<size_t>(y) * (width + 1) + x) * 3;
+    }
+
+    template <typename Sum>
+    void rectangleSum(int x0, int y0, int x1, int y1, uint64_t sums[3]) const {
+        const Sum* a = at<Sum>(x0, y0);
+        const Sum* b = at<Sum>(x1, y0);
+        const Sum* c = at<Sum>(x0, y1);
+        const Sum* d = at<Sum>(x1, y1);
+        for (int ch = 0; ch < 3; ++ch) {
+            sums[ch] = static_cast<Sum>(d[ch] - b[ch] - c[ch] + a[ch]);
+        }
+    }
+
+    int width = 0;
+    int height = 0;
+    bool wide = false;   // sumas de 64 bits en lugar de 32
+    ScratchBuffer table; // (width + 1) * (height + 1) * 3 sumas, del pool de buffers
+};
+
+#endif // INTEGRAL_H
@@ -0,0 +1,151 @@
+#include "pipeline.h"
+#include "autotune.h"
+#include "filters.h"
+#include "../utils/threadpool.h"
+#include "../utils/trace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void applyPipeline(BmpImage& img, const vector<FilterStep>& steps, int threads) {
+    size_t i = 0;
+    while (i < steps.size()) {
+        // Juntar la corrida más larga de filtros punto a punto que arranca en este paso
+        PointProgram program;
+        size_t end = i;
+        while (end < steps.size() && compilePointStep(program, steps[end].name, steps[end].parameters)) {
+            ++end;
+        }
+        if (end - i >= 2) {
+            // Una sola pasada por la imagen en lugar de una pasada por filtro
+            string name = steps[i].name;
+            for (size_t k = i + 1; k < end; ++k) name += "+" + steps[k].name;
+            vector<FilterStep> run(steps.begin() + i, steps.begin() + end);
+            int runThreads = stepsThreads(threads, run, img.getWidth(), img.getHeight());
+            TraceScope trace("filtro", name);
+            program.apply(img, runThreads);
+            i = end;
+        } else {
+            // Un filtro suelto se aplica con su propia implementación (los punto a punto son vectoriales)
+            applyFilter(img, steps[i].name, steps[i].parameters, stepThreads(threads, steps[i], img.getWidth(), img.getHeight()));
+            ++i;
+        }
+    }
+}
+
+int pipelineHalo(const vector<FilterStep>& steps) {
+    int halo = 0;
+    for (const auto& step : steps) {
+        halo += filterReach(step.name, step.parameters);
+    }
+    return halo;
+}
+
+// Halo máximo para fusionar por bloques: con halos más grandes se recalcula más de lo que se ahorra
+static const int MAX_FUSED_HALO = 64;
+
+void applyPipelineFused(BmpImage& img, const vector<FilterStep>& steps, int threads) {
+    // Los filtros de imagen completa cortan el pipeline: lo de antes y lo de después se fusiona aparte
+    auto whole = find_if(steps.begin(), steps.end(), [](const FilterStep& step) { return needsWholeImage(step.name); });
+    if (whole != steps.end()) {
+        applyPipelineFused(img, vector<FilterStep>(steps.begin(), whole), threads);
+        applyFilter(img, whole->name, whole->parameters, stepThreads(threads, *whole, img.getWidth(), img.getHeight()));
+        applyPipelineFused(img, vector<FilterStep>(whole + 1, steps.end()), threads);
+        return;
+    }
+
+    int width = img.getWidth();
+    int height = img.getHeight();
+    int halo = pipelineHalo(steps);
+    // Sin filtros con kernel no hay nada que recalcular: applyPipeline ya junta los punto a punto
+    if (steps.size() < 2 || halo == 0 || halo > MAX_FUSED_HALO || width == 0 || height == 0) {
+        applyPipeline(img, steps, threads);
+        return;
+    }
+    // Todos los pasos se aplican juntos en cada bloque: se usan los hilos del paso que más aprovecha
+    threads = stepsThreads(threads, steps, width, height);
+
+    // Los bloques crecen con el halo para que el recálculo de los bordes no domine
+    int tileWidth = max(KERNEL_TILE_WIDTH, 4 * halo);
+    int tileHeight = max(KERNEL_TILE_HEIGHT, 4 * halo);
+    int tilesX = (width + tileWidth - 1) / tileWidth;
+    int tilesY = (height + tileHeight - 1) / tileHeight;
+
+    // Los bloques leen su halo de img, así que el resultado va a otra imagen hasta terminar
+    BmpImage output;
+    output.create(width, height);
+    const BmpImage& source = img;
+    threadPool().parallelFor(threads, 0, tilesX * tilesY, 1, [&](int tileStart, int tileEnd) {
+        BmpImage tile;
+        for (int t = tileStart; t < tileEnd; ++t) {
+            int xStart = (t % tilesX) * tileWidth;
+            int yStart = (t / tilesX) * tileHeight;
+            int xEnd = min(width, xStart + tileWidth);
+            int yEnd = min(height, yStart + tileHeight);
+
+            // Copiar el bloque con su halo (recortado a la imagen) y aplicarle todo el pipeline
+            int left = max(0, xStart - halo), right = min(width, xEnd + halo);
+            int top = max(0, yStart - halo), bottom = min(height, yEnd + halo);
+            if (tile.getWidth() != right - left || tile.getHeight() != bottom - top) {
+                tile.create(right - left, bottom - top);
+            }
+            for (int y = top; y < bottom; ++y) {
+                memcpy(tile.getRowData(y - top), source.getRow(y).data() + left, (right - left) * sizeof(RGB));
+            }
+            applyPipeline(tile, steps, 1);
+
+            // Sólo el centro del bloque queda igual que si se hubiera filtrado la imagen entera
+            for (int y = yStart; y < yEnd; ++y) {
+                memcpy(output.getRow(y).data() + xStart, tile.getRow(y - top).data() + (xStart - left), (xEnd - xStart) * sizeof(RGB));
+            }
+        }
+    });
+    img.swapPixels(output);
+}
+
+void applyPipelinePlanar(BmpImage& img, const vector<FilterStep>& steps, int threads) {
+    int conversionThreads = stepsThreads(threads, steps, img.getWidth(), img.getHeight());
+    PlanarImage planar;
+    planar.fromImage(img, conversionThreads);
+    for (const auto& step : steps) {
+        int filterThreads = stepThreads(threads, step, img.getWidth(), img.getHeight());
+        if (applyPlanarFilter(planar, step.name, step.parameters, filterThreads)) continue;
+        // El filtro no tiene versión sobre planos: se aplica sobre la imagen intercalada
+        planar.toImage(img, conversionThreads);
+        applyFilter(img, step.name, step.parameters, filterThreads);
+        planar.fromImage(img, conversionThreads);
+    }
+    planar.toImage(img, conversionThreads);
+}
+
+bool applyPipelineInStrips(const string& inputFile, const string& outputFile, const vector<FilterStep>& steps, int threads, int stripRows) {
+    for (const auto& step : steps) {
+        if (needsWholeImage(step.name)) {
+            throw invalid_argument("El filtro '" + step.name + "' necesita la imagen completa y no se puede aplicar por franjas");
+        }
+    }
+
+    BmpReader reader;
+    if (!reader.open(inputFile)) return false;
+    BmpWriter writer;
+    if (!writer.open(outputFile, reader)) return false;
+
+    int height = reader.getHeight();
+    int halo = pipelineHalo(steps);
+    stripRows = max(1, stripRows);
+
+    BmpImage strip;
+    for (int y = 0; y < height; y += stripRows) {
+        int rows = min(stripRows, height - y);
+        int top = max(0, y - halo);
+        int bottom = min(height, y + rows + halo);
+        {
+            TraceScope trace("etapa", "lectura");
+            if (!reader.read(top, bottom - top, strip)) return false;
+        }
+        applyPipelineFused(strip, steps, threads);
+        TraceScope trace("etapa", "escritura");
+        if (!writer.write(strip, y - top, rows, y)) return false;
+    }
+    return writer.close();
+}
@@ -0,0 +1,74 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "../BMPImage.h"
+#include "../utils/utils.h"
+#include "autotune.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Aplica todos los pasos de un pipeline, en orden, sobre una imagen.
+ * @param img Imagen a la que se le aplicarán los filtros.
+ * @param steps Pasos del pipeline (ver parsePipeline).
+ * @param threads Número de threads a utilizar, o AUTO_THREADS para elegirlos en cada paso (ver
+ * autoThreads). Lo mismo vale para los demás pipelines.
+ * @throws runtime_error Si algún filtro no está registrado (y lo que lance cada filtro).
+ * @details Las corridas de dos o más filtros punto a punto seguidos se compilan (ver PointProgram)
+ * y se aplican con una sola pasada sobre la imagen.
+ */
+void applyPipeline(BmpImage& img, const vector<FilterStep>& steps, int threads);
+
+/**
+ * @brief Calcula cuántas filas de contexto necesita un pipeline alrededor de una franja.
+ * @details Cada filtro con kernel lee hasta su radio de filas por encima y por debajo, y los errores
+ * de borde de un paso se propagan a los siguientes, así que el halo es la suma de los alcances.
+ */
+int pipelineHalo(const vector<FilterStep>& steps);
+
+/**
+ * @brief Aplica todos los pasos de un pipeline bloque por bloque, mientras el bloque está en caché.
+ * @param img Imagen a la que se le aplicarán los filtros.
+ * @param steps Pasos del pipeline.
+ * @param threads Número de threads a utilizar (cada bloque lo procesa un solo hilo).
+ * @details Cada bloque se copia con pipelineHalo() píxeles extra de cada lado, se le aplica el
+ * pipeline completo y se guarda sólo su centro: el solapamiento entre bloques se recalcula en lugar
+ * de escribir imágenes intermedias, así que la imagen se recorre en memoria una sola vez. El
+ * resultado es igual al de applyPipeline. Con un solo paso, sin filtros con kernel (halo 0) o con
+ * un halo muy grande, se usa applyPipeline directamente. Los filtros de imagen completa (ver
+ * registerWholeImageFilter) se aplican sobre toda la imagen, y los pasos de antes y de después se
+ * fusionan por separado.
+ * @throws runtime_error Si algún filtro no está registrado (y lo que lance cada filtro).
+ */
+void applyPipelineFused(BmpImage& img, const vector<FilterStep>& steps, int threads);
+
+/**
+ * @brief Aplica todos los pasos de un pipeline sobre la imagen separada en planos (ver PlanarImage).
+ * @param img Imagen a la que se le aplicarán los filtros.
+ * @param steps Pasos del pipeline.
+ * @param threads Número de threads a utilizar.
+ * @details Los canales se separan una vez al empezar y se vuelven a intercalar una vez al terminar,
+ * así que en pipelines largos la conversión se paga una sola vez. Los filtros sin versión sobre
+ * planos se aplican sobre la imagen intercalada, convirtiendo antes y después. El resultado es igual
+ * al de applyPipeline.
+ * @throws runtime_error Si algún filtro no está registrado (y lo que lance cada filtro).
+ */
+void applyPipelinePlanar(BmpImage& img, const vector<FilterStep>& steps, int threads);
+
+/**
+ * @brief Aplica un pipeline a un archivo por franjas horizontales, sin cargar la imagen completa.
+ * @param inputFile Imagen de entrada.
+ * @param outputFile Imagen de salida. Se sobrescribe si ya existe.
+ * @param steps Pasos del pipeline.
+ * @param threads Número de threads a utilizar en cada franja.
+ * @param stripRows Cantidad de filas de salida por franja.
+ * @return True si se pudo leer y escribir todo, false en caso contrario.
+ * @details Cada franja se lee con pipelineHalo() filas extra de cada lado, se le aplica el pipeline
+ * completo y se escriben sólo sus filas centrales, que quedan igual que si se hubiera filtrado la
+ * imagen entera. La memoria usada depende de stripRows y del halo, no del tamaño de la imagen.
+ * @throws runtime_error Si algún filtro no está registrado (y lo que lance cada filtro).
+ * @throws invalid_argument Si algún filtro necesita la imagen completa (ver registerWholeImageFilter).
+ */
+bool applyPipelineInStrips(const string& inputFile, const string& outputFile, const vector<FilterStep>& steps, int threads, int stripRows);
+
+#endif // PIPELINE_H
@@ -0,0 +1,39 @@
+#ifndef PIXELMATH_H
+#define PIXELMATH_H
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// Cuentas en punto fijo que comparten las versiones intercaladas, vectoriales y sobre planos de los
+// filtros, para que todas den exactamente lo mismo.
+
+/**
+ * @brief Satura un valor entero al rango de un canal de color [0, 255].
+ */
+inline uint8_t clampChannel(int value) {
+    return static_cast<uint8_t>(clamp(value, 0, 255));
+}
+
+/**
+ * @brief Calcula la luminancia de un pixel en punto fijo.
+ * @details Usa los pesos 0.299, 0.587 y 0.114 escalados a 256 (77 + 150 + 29 = 256), por lo que
+ * un pixel gris (r = g = b) conserva su valor.
+ */
+inline uint8_t luminance(uint32_t blue, uint32_t green, uint32_t red) {
+    return static_cast<uint8_t>((77 * red + 150 * green + 29 * blue + 128) >> 8);
+}
+
+/**
+ * @brief Combina un canal original con su versión desenfocada: orig + fuerza * (orig - blur),
+ * redondeando hacia afuera.
+ * @param strength Fuerza de la máscara en porcentaje (100 = 1.0).
+ */
+inline uint8_t sharpenChannel(int original, int blurred, int strength) {
+    int delta = (original - blurred) * strength;
+    int rounded = delta >= 0 ? (delta + 50) / 100 : (delta - 50) / 100;
+    return clampChannel(original + rounded);
+}
+
+#endif // PIXELMATH_H
@@ -0,0 +1,284 @@
+#include "planar.h"
+#include "filters.h"
+#include "gaussian.h"
+#include "histogram.h"
+#include "pixelmath.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <cstring>
+
+void PlanarImage::create(int width, int height) {
+    this->width = width;
+    this->height = height;
+    stride = (width + 63) / 64 * 64;
+    data.resize(static_cast<size_t>(stride) * height * 3);
+}
+
+void PlanarImage::swap(PlanarImage& other) {
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    std::swap(stride, other.stride);
+    std::swap(data, other.data);
+}
+
+void PlanarImage::fromImage(const BmpImage& img, int threads) {
+    create(img.getWidth(), img.getHeight());
+    threadPool().parallelFor(threads, 0, height, rowGrain(img, 0), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            const uint8_t* pixels = img.getRowData(y);
+            uint8_t* blue = row(0, y);
+            uint8_t* green = row(1, y);
+            uint8_t* red = row(2, y);
+            for (int x = 0; x < width; ++x) {
+                blue[x] = pixels[x * 3];
+                green[x] = pixels[x * 3 + 1];
+                red[x] = pixels[x * 3 + 2];
+            }
+        }
+    });
+}
+
+void PlanarImage::toImage(BmpImage& img, int threads) const {
+    if (img.getWidth() != width || img.getHeight() != height) {
+        img.create(width, height);
+    }
+    threadPool().parallelFor(threads, 0, height, rowGrain(img, 0), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            uint8_t* pixels = img.getRowData(y);
+            const uint8_t* blue = row(0, y);
+            const uint8_t* green = row(1, y);
+            const uint8_t* red = row(2, y);
+            for (int x = 0; x < width; ++x) {
+                pixels[x * 3] = blue[x];
+                pixels[x * 3 + 1] = green[x];
+                pixels[x * 3 + 2] = red[x];
+            }
+        }
+    });
+}
+
+/**
+ * @brief Planos auxiliares de los filtros con kernel (uno por hilo, como kernelScratch).
+ */
+static thread_local PlanarImage planarScratch;
+
+void releasePlanarBuffers() {
+    planarScratch = PlanarImage();
+}
+
+/**
+ * @brief Filas por bloque de trabajo, con el mismo criterio que rowGrain.
+ */
+static int planarGrain(const PlanarImage& img) {
+    return max(1, 16384 / max(1, img.getWidth()));
+}
+
+void negativePlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+        for (int c = 0; c < 3; ++c) {
+            for (int y = yStart; y < yEnd; ++y) {
+                uint8_t* plane = img.row(c, y);
+                for (int x = 0; x < width; ++x) {
+                    plane[x] = 255 - plane[x];
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Convierte a gris (y cuantiza con el paso dado) las filas [yStart, yEnd).
+ * @details La división por step se hace con el mismo multiplicador que los kernels SIMD, que es
+ * exacto para valores menores a 256.
+ */
+static void quantizedGrayRows(PlanarImage& img, int yStart, int yEnd, int step) {
+    int width = img.getWidth();
+    uint32_t reciprocal = step > 1 ? (65536 + step - 1) / step : 0;
+    for (int y = yStart; y < yEnd; ++y) {
+        uint8_t* blue = img.row(0, y);
+        uint8_t* green = img.row(1, y);
+        uint8_t* red = img.row(2, y);
+        for (int x = 0; x < width; ++x) {
+            uint32_t gray = luminance(blue[x], green[x], red[x]);
+            if (step > 1) gray = (gray * reciprocal >> 16) * step;
+            blue[x] = green[x] = red[x] = static_cast<uint8_t>(gray);
+        }
+    }
+}
+
+void grayscalePlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+        quantizedGrayRows(img, yStart, yEnd, 1);
+    });
+}
+
+void thresholdPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    int step = 256 / thresholdLevels(params);
+    threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+        quantizedGrayRows(img, yStart, yEnd, step);
+    });
+}
+
+/**
+ * @brief Box blur de los tres planos de src, escrito en dst (que debe tener el mismo tamaño).
+ * @details Cada bloque de filas mantiene las sumas por columna de las filas del kernel y las
+ * actualiza al bajar una fila. En el interior de cada fila todas las ventanas tienen la misma
+ * cantidad de píxeles, así que la división se reemplaza por una multiplicación por el recíproco,
+ * exacta mientras la ventana tenga menos de 2^24 píxeles (el mismo límite que la imagen integral);
+ * las ventanas más grandes dividen. Las sumas prefijas son de 64 bits, porque la suma de una ventana
+ * que cubre una imagen grande pasa de 2^32.
+ */
+static void boxBlurPlanes(const PlanarImage& src, PlanarImage& dst, int radius, int threads) {
+    int width = src.getWidth();
+    int height = src.getHeight();
+    threadPool().parallelFor(threads, 0, height, planarGrain(src), [&](int yStart, int yEnd) {
+        vector<uint32_t> columns(width);
+        vector<uint64_t> prefix(width + 1);
+        for (int c = 0; c < 3; ++c) {
+            int y0 = max(0, yStart - radius);
+            int y1 = min(height, yStart + radius + 1);
+            fill(columns.begin(), columns.end(), 0);
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t* plane = src.row(c, y);
+                for (int x = 0; x < width; ++x) columns[x] += plane[x];
+            }
+
+            for (int y = yStart; y < yEnd; ++y) {
+                // Bajar la ventana una fila: entra la de abajo y sale la de arriba
+                if (y > yStart) {
+                    if (y + radius < height) {
+                        const uint8_t* entering = src.row(c, y + radius);
+                        for (int x = 0; x < width; ++x) columns[x] += entering[x];
+                        ++y1;
+                    }
+                    if (y - radius - 1 >= 0) {
+                        const uint8_t* leaving = src.row(c, y - radius - 1);
+                        for (int x = 0; x < width; ++x) columns[x] -= leaving[x];
+                        ++y0;
+                    }
+                }
+                uint32_t rows = y1 - y0;
+
+                prefix[0] = 0;
+                for (int x = 0; x < width; ++x) prefix[x + 1] = prefix[x] + columns[x];
+
+                uint8_t* out = dst.row(c, y);
+                int interiorStart = min(width, radius);
+                int interiorEnd = max(interiorStart, width - radius);
+                uint64_t count = static_cast<uint64_t>(2 * radius + 1) * rows;
+                bool useReciprocal = count < (1u << 24);
+                uint64_t reciprocal = useReciprocal ? ((uint64_t(1) << 56) + count - 1) / count : 0;
+                for (int x = 0; x < width; ++x) {
+                    if (x == interiorStart && useReciprocal) {
+                        for (; x < interiorEnd; ++x) {
+                            uint64_t sum = prefix[x + radius + 1] - prefix[x - radius] + count / 2;
+                            out[x] = static_cast<uint8_t>((sum * reciprocal) >> 56);
+                        }
+                        if (x >= width) break;
+                    }
+                    int x0 = max(0, x - radius), x1 = min(width, x + radius + 1);
+                    uint64_t windowCount = static_cast<uint64_t>(x1 - x0) * rows;
+                    out[x] = static_cast<uint8_t>((prefix[x1] - prefix[x0] + windowCount / 2) / windowCount);
+                }
+            }
+        }
+    });
+}
+
+void boxBlurPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    int radius = kernelRadius(params);
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+    planarScratch.create(img.getWidth(), img.getHeight());
+    boxBlurPlanes(img, planarScratch, radius, threads);
+    img.swap(planarScratch);
+}
+
+/**
+ * @brief Desenfoque gaussiano, en el lugar, de los tres planos.
+ */
+static void gaussianPlanes(PlanarImage& img, double sigma, int threads) {
+    gaussianBlur([&](int channel, int y) { return img.row(channel, y); }, 3, 1,
+                 img.getWidth(), img.getHeight(), sigma, threads);
+}
+
+void gaussianPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    gaussianPlanes(img, gaussianSigma(params), threads);
+}
+
+void unsharpMaskPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    bool gaussian = unsharpUsesGaussian(params);
+    int radius = gaussian ? 0 : kernelRadius(params);
+    double sigma = gaussian ? gaussianSigma(params) : 0;
+    int strength = unsharpStrength(params);
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+
+    // Referencia local: dentro de las tareas, planarScratch sería el de cada hilo del pool
+    PlanarImage& blurred = planarScratch;
+    blurred.create(img.getWidth(), img.getHeight());
+    if (gaussian) {
+        threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+            for (int c = 0; c < 3; ++c) {
+                for (int y = yStart; y < yEnd; ++y) {
+                    memcpy(blurred.row(c, y), img.row(c, y), img.getWidth());
+                }
+            }
+        });
+        gaussianPlanes(blurred, sigma, threads);
+    } else {
+        boxBlurPlanes(img, blurred, radius, threads);
+    }
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+        for (int c = 0; c < 3; ++c) {
+            for (int y = yStart; y < yEnd; ++y) {
+                uint8_t* plane = img.row(c, y);
+                const uint8_t* blur = blurred.row(c, y);
+                for (int x = 0; x < width; ++x) {
+                    plane[x] = sharpenChannel(plane[x], blur[x], strength);
+                }
+            }
+        }
+    });
+}
+
+void adaptiveThresholdPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    int radius = kernelRadius(params);
+    int offset = params.size() > 1 ? stoi(params[1]) : 0;
+    if (img.getWidth() == 0 || img.getHeight() == 0) return;
+
+    // Referencia local: dentro de las tareas, planarScratch sería el de cada hilo del pool
+    PlanarImage& blurred = planarScratch;
+    blurred.create(img.getWidth(), img.getHeight());
+    boxBlurPlanes(img, blurred, radius, threads);
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), planarGrain(img), [&](int yStart, int yEnd) {
+        for (int y = yStart; y < yEnd; ++y) {
+            uint8_t* blue = img.row(0, y);
+            uint8_t* green = img.row(1, y);
+            uint8_t* red = img.row(2, y);
+            const uint8_t* meanBlue = blurred.row(0, y);
+            const uint8_t* meanGreen = blurred.row(1, y);
+            const uint8_t* meanRed = blurred.row(2, y);
+            for (int x = 0; x < width; ++x) {
+                int localMean = luminance(meanBlue[x], meanGreen[x], meanRed[x]);
+                int gray = luminance(blue[x], green[x], red[x]);
+                uint8_t value = gray > localMean - offset ? 255 : 0;
+                blue[x] = green[x] = red[x] = value;
+            }
+        }
+    });
+}
+
+void equalizePlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    auto row = [&](int channel, int y) { return img.row(channel, y); };
+    ImageHistogram histogram = imageHistogram(row, 1, img.getWidth(), img.getHeight(), threads);
+    applyChannelTables(row, 1, img.getWidth(), img.getHeight(), equalizeTables(histogram), threads);
+}
+
+void autolevelsPlanarFilter(PlanarImage& img, const vector<string>& params, int threads) {
+    double clip = autolevelsClip(params);
+    auto row = [&](int channel, int y) { return img.row(channel, y); };
+    ImageHistogram histogram = imageHistogram(row, 1, img.getWidth(), img.getHeight(), threads);
+    applyChannelTables(row, 1, img.getWidth(), img.getHeight(), autolevelsTables(histogram, clip), threads);
+}
@@ -0,0 +1,120 @@
+#ifndef PLANAR_H
+#define PLANAR_H
+
+#include "../BMPImage.h"
+#include "../utils/bufferpool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Imagen con un plano separado por canal (SoA), en lugar de píxeles BGR intercalados.
+ * @details Cada plano guarda un byte por píxel, con las filas de arriba hacia abajo y alineadas a
+ * 64 bytes (el relleno del final de cada fila no se usa). Así los bucles internos de los filtros
+ * recorren arreglos de bytes contiguos, que el compilador vectoriza sin tener que separar canales.
+ * Se convierte una vez desde la BmpImage al empezar el pipeline y se vuelve a intercalar al final.
+ */
+class PlanarImage {
+public:
+    /**
+     * @brief Reserva los planos para una imagen de width x height (el contenido queda sin definir).
+     */
+    void create(int width, int height);
+
+    /**
+     * @brief Separa los canales de una imagen en planos.
+     * @param img Imagen de origen.
+     * @param threads Número de threads a utilizar.
+     */
+    void fromImage(const BmpImage& img, int threads);
+
+    /**
+     * @brief Intercala los planos en una imagen del mismo tamaño.
+     * @param img Imagen de destino. Si no tiene el tamaño de los planos, se vuelve a crear.
+     * @param threads Número de threads a utilizar.
+     */
+    void toImage(BmpImage& img, int threads) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /**
+     * @brief Distancia en bytes entre el comienzo de dos filas seguidas de un plano.
+     */
+    int getStride() const { return stride; }
+
+    /**
+     * @brief Obtiene una fila de un plano.
+     * @param channel Canal (0 = azul, 1 = verde, 2 = rojo).
+     * @param y Fila, contando desde arriba.
+     */
+    uint8_t* row(int channel, int y) { return data.data() + (static_cast<size_t>(channel) * height + y) * stride; }
+    const uint8_t* row(int channel, int y) const { return data.data() + (static_cast<size_t>(channel) * height + y) * stride; }
+
+    /**
+     * @brief Intercambia los planos con otra imagen, sin copiarlos.
+     */
+    void swap(PlanarImage& other);
+
+private:
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    ScratchBuffer data;
+};
+
+/**
+ * @brief Filtro negativo sobre planos.
+ */
+void negativePlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Escala de grises sobre planos (misma luminancia en punto fijo que grayscaleFilter).
+ */
+void grayscalePlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Umbral sobre planos (params[0] = la cantidad de niveles de gris).
+ */
+void thresholdPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Box blur sobre planos (params[0] = tamaño del kernel).
+ * @details Es separable: para cada fila se mantienen las sumas de las columnas del kernel, que se
+ * actualizan sumando la fila que entra y restando la que sale, y después se recorre la fila con una
+ * ventana deslizante. Da exactamente lo mismo que boxBlurFilter.
+ */
+void boxBlurPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Desenfoque gaussiano sobre planos (params[0] = sigma). Da lo mismo que gaussianFilter.
+ */
+void gaussianPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Máscara de desenfoque sobre planos (los mismos parámetros que unsharpMaskFilter).
+ */
+void unsharpMaskPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Umbral adaptativo sobre planos (params[0] = tamaño del kernel, params[1] = desplazamiento).
+ */
+void adaptiveThresholdPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Ecualización de histograma sobre planos. Da lo mismo que equalizeFilter.
+ */
+void equalizePlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Niveles automáticos sobre planos (los mismos parámetros que autolevelsFilter).
+ */
+void autolevelsPlanarFilter(PlanarImage& img, const vector<string>& params, int threads = 1);
+
+/**
+ * @brief Libera los planos auxiliares que los filtros sobre planos reutilizan entre pasos.
+ * @details Libera sólo los del hilo que la llama (como releaseFilterBuffers).
+ */
+void releasePlanarBuffers();
+
+#endif // PLANAR_H
@@ -0,0 +1,114 @@
+#include "point.h"
+#include "filters.h"
+#include "../utils/threadpool.h"
+
+// Pesos de la luminancia en punto fijo, en el orden de los canales (azul, verde, rojo)
+static const uint16_t LUMINANCE_WEIGHTS[3] = { 29, 150, 77 };
+
+PointProgram::Pass::Pass() {
+    for (int c = 0; c < 3; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            table[c][v] = static_cast<uint8_t>(v);
+            weighted[c][v] = static_cast<uint16_t>(LUMINANCE_WEIGHTS[c] * v);
+        }
+    }
+}
+
+PointProgram::Pass& PointProgram::tablePass() {
+    if (passes.empty() || passes.back().kernel) {
+        passes.emplace_back();
+    }
+    return passes.back();
+}
+
+void PointProgram::map(const function<uint8_t(int, uint8_t)>& func) {
+    // En las dos formas la salida sale de table, así que alcanza con componer sobre ella
+    Pass& pass = tablePass();
+    for (int c = 0; c < 3; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            pass.table[c][v] = func(c, pass.table[c][v]);
+        }
+    }
+}
+
+void PointProgram::luminance() {
+    Pass& pass = tablePass();
+    if (!pass.usesLuminance) {
+        // La luminancia de la salida por canal se calcula directo desde la entrada, con los pesos
+        // metidos en las tablas
+        for (int c = 0; c < 3; ++c) {
+            for (int v = 0; v < 256; ++v) {
+                pass.weighted[c][v] = static_cast<uint16_t>(LUMINANCE_WEIGHTS[c] * pass.table[c][v]);
+                pass.table[c][v] = static_cast<uint8_t>(v);
+            }
+        }
+        pass.usesLuminance = true;
+        return;
+    }
+    // Ya hay un gris intermedio: la nueva luminancia es una función de ese gris
+    for (int v = 0; v < 256; ++v) {
+        int sum = LUMINANCE_WEIGHTS[0] * pass.table[0][v] + LUMINANCE_WEIGHTS[1] * pass.table[1][v] + LUMINANCE_WEIGHTS[2] * pass.table[2][v];
+        uint8_t gray = static_cast<uint8_t>((sum + 128) >> 8);
+        pass.table[0][v] = pass.table[1][v] = pass.table[2][v] = gray;
+    }
+}
+
+void PointProgram::rowKernel(function<void(uint8_t*, int)> kernel) {
+    Pass pass;
+    pass.kernel = move(kernel);
+    passes.push_back(move(pass));
+}
+
+/**
+ * @brief Aplica tablas por canal a una tira de píxeles.
+ * @details Las tablas se pasan como punteros restrict: así el compilador sabe que escribir en la
+ * fila no las modifica y puede adelantar las lecturas de los píxeles siguientes.
+ */
+static void mapChannels(uint8_t* __restrict data, int pixels, const uint8_t* __restrict blue,
+                        const uint8_t* __restrict green, const uint8_t* __restrict red) {
+    for (int i = 0; i < pixels; ++i, data += 3) {
+        uint8_t b = blue[data[0]], g = green[data[1]], r = red[data[2]];
+        data[0] = b;
+        data[1] = g;
+        data[2] = r;
+    }
+}
+
+/**
+ * @brief Aplica tablas con luminancia a una tira de píxeles (ver mapChannels).
+ */
+static void mapLuminance(uint8_t* __restrict data, int pixels, const uint16_t* __restrict weightBlue,
+                         const uint16_t* __restrict weightGreen, const uint16_t* __restrict weightRed,
+                         const uint8_t* __restrict blue, const uint8_t* __restrict green, const uint8_t* __restrict red) {
+    for (int i = 0; i < pixels; ++i, data += 3) {
+        int gray = (weightBlue[data[0]] + weightGreen[data[1]] + weightRed[data[2]] + 128) >> 8;
+        uint8_t b = blue[gray], g = green[gray], r = red[gray];
+        data[0] = b;
+        data[1] = g;
+        data[2] = r;
+    }
+}
+
+void PointProgram::applyRow(uint8_t* data, int pixels) const {
+    for (const Pass& pass : passes) {
+        if (pass.kernel) {
+            pass.kernel(data, pixels);
+        } else if (!pass.usesLuminance) {
+            mapChannels(data, pixels, pass.table[0].data(), pass.table[1].data(), pass.table[2].data());
+        } else {
+            mapLuminance(data, pixels, pass.weighted[0].data(), pass.weighted[1].data(), pass.weighted[2].data(),
+                         pass.table[0].data(), pass.table[1].data(), pass.table[2].data());
+        }
+    }
+}
+
+void PointProgram::apply(BmpImage& img, int threads) const {
+    int width = img.getWidth();
+    threadPool().parallelFor(threads, 0, img.getHeight(), rowGrain(img, 0), [&](int yStart, int yEnd) {
+        // Cada fila pasa por todo el programa antes de seguir con la próxima, así se lee y se
+        // escribe en memoria una sola vez
+        for (int y = yStart; y < yEnd; ++y) {
+            applyRow(img.getRowData(y), width);
+        }
+    });
+}
@@ -0,0 +1,74 @@
+#ifndef POINT_H
+#define POINT_H
+
+#include "../BMPImage.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Corrida de filtros punto a punto compilada para aplicarse con una sola pasada por la imagen.
+ * @details Es una lista de operaciones por fila que se aplican una detrás de otra sobre cada fila,
+ * mientras la fila está en caché. Hay dos tipos de operaciones:
+ * - Kernels vectoriales (por ejemplo negateRow), que se llaman tal cual.
+ * - Tablas de 256 entradas por canal. Las funciones por canal y las conversiones a luminancia que
+ *   se componen seguidas se juntan en una sola tabla, así que cuestan una búsqueda por canal sin
+ *   importar cuántas sean. Una tabla tiene dos formas:
+ *   - Por canal: salida[c] = table[c][entrada[c]].
+ *   - Con luminancia: gris = (weighted[0][b] + weighted[1][g] + weighted[2][r] + 128) >> 8 y
+ *     salida[c] = table[c][gris]. Las funciones por canal anteriores a la luminancia quedan dentro
+ *     de las tablas con peso.
+ */
+class PointProgram {
+public:
+    /**
+     * @brief Compone una función por canal después de lo acumulado.
+     * @param func Recibe el canal (0 = azul, 1 = verde, 2 = rojo) y su valor, y devuelve el nuevo valor.
+     */
+    void map(const function<uint8_t(int channel, uint8_t value)>& func);
+
+    /**
+     * @brief Compone la conversión a luminancia (77 * r + 150 * g + 29 * b + 128) / 256 después de
+     * lo acumulado. Los tres canales de la salida quedan iguales.
+     */
+    void luminance();
+
+    /**
+     * @brief Compone un kernel que procesa una tira de píxeles BGR empaquetados (como los de simd.h).
+     */
+    void rowKernel(function<void(uint8_t*, int)> kernel);
+
+    /**
+     * @brief Aplica el programa sobre cada fila de la imagen, usando múltiples hilos.
+     */
+    void apply(BmpImage& img, int threads) const;
+
+    /**
+     * @brief Aplica el programa a una tira de píxeles BGR empaquetados.
+     */
+    void applyRow(uint8_t* data, int pixels) const;
+
+private:
+    /**
+     * @brief Una operación del programa: un kernel, o una tabla si kernel está vacío.
+     */
+    struct Pass {
+        Pass();
+
+        function<void(uint8_t*, int)> kernel;
+        bool usesLuminance = false;
+        array<array<uint16_t, 256>, 3> weighted;
+        array<array<uint8_t, 256>, 3> table;
+    };
+
+    /**
+     * @brief Obtiene la tabla sobre la que componer: la última operación si es una tabla, o una
+     * tabla identidad nueva.
+     */
+    Pass& tablePass();
+
+    vector<Pass> passes;
+};
+
+#endif // POINT_H
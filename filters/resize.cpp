@@ -0,0 +1,163 @@
+#include "resize.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Tamaño máximo de cada lado del resultado: las filas se indexan con int (3 bytes por pixel).
+ */
+static const int64_t RESIZE_MAX_SIZE = INT_MAX / 4;
+
+pair<int, int> resizeTarget(const vector<string>& params, int width, int height) {
+    if (params.empty()) {
+        throw invalid_argument("Falta el ancho del resize");
+    }
+    int64_t targetWidth = stoll(params[0]);
+    int64_t targetHeight = params.size() > 1 ? stoll(params[1]) : 0;
+    if (targetWidth < 0 || targetHeight < 0 || (targetWidth == 0 && targetHeight == 0)) {
+        throw invalid_argument("El tamaño del resize debe ser positivo");
+    }
+    // Un lado en 0 se calcula a partir del otro, manteniendo la proporción
+    if (targetHeight == 0) {
+        targetHeight = max<int64_t>(1, llround(static_cast<double>(height) * targetWidth / max(1, width)));
+    } else if (targetWidth == 0) {
+        targetWidth = max<int64_t>(1, llround(static_cast<double>(width) * targetHeight / max(1, height)));
+    }
+    if (targetWidth > RESIZE_MAX_SIZE || targetHeight > RESIZE_MAX_SIZE) {
+        throw invalid_argument("El tamaño del resize es demasiado grande");
+    }
+    return { static_cast<int>(targetWidth), static_cast<int>(targetHeight) };
+}
+
+pair<int, int> scaleTarget(const vector<string>& params, int width, int height) {
+    if (params.empty()) {
+        throw invalid_argument("Falta el factor de escala");
+    }
+    double factor = stod(params[0]);
+    if (!(factor > 0) || !isfinite(factor)) {
+        throw invalid_argument("El factor de escala debe ser positivo");
+    }
+    double targetWidth = max(1.0, round(width * factor));
+    double targetHeight = max(1.0, round(height * factor));
+    if (targetWidth > RESIZE_MAX_SIZE || targetHeight > RESIZE_MAX_SIZE) {
+        throw invalid_argument("El factor de escala es demasiado grande");
+    }
+    return { static_cast<int>(targetWidth), static_cast<int>(targetHeight) };
+}
+
+/**
+ * @brief Bits fraccionarios de los pesos: los pesos de cada pixel de destino suman 2^16.
+ */
+static const int WEIGHT_BITS = 16;
+
+/**
+ * @brief Pesos de los píxeles de origen que cubre cada pixel de destino, a lo largo de un eje.
+ * @details Los pesos del pixel i son weights[offsets[i]] ... weights[offsets[i + 1] - 1] y
+ * corresponden a los píxeles de origen first[i], first[i] + 1, ...
+ */
+struct AreaWeights {
+    vector<int> first;
+    vector<uint32_t> offsets;
+    vector<uint32_t> weights;
+
+    int count(int i) const { return offsets[i + 1] - offsets[i]; }
+    const uint32_t* of(int i) const { return weights.data() + offsets[i]; }
+};
+
+/**
+ * @brief Calcula los pesos de área para pasar de sourceSize a targetSize píxeles.
+ * @details Medido en unidades de 1 / (sourceSize * targetSize), el pixel de origen j ocupa
+ * [j * targetSize, (j + 1) * targetSize) y el de destino i ocupa [i * sourceSize, (i + 1) * sourceSize),
+ * así que los solapamientos son enteros exactos. Se redondean los solapamientos acumulados (y no
+ * cada uno por separado) para que los pesos de cada pixel sumen exactamente 2^16.
+ */
+static AreaWeights areaWeights(int sourceSize, int targetSize) {
+    AreaWeights result;
+    result.first.resize(targetSize);
+    result.offsets.resize(targetSize + 1);
+    int64_t source = sourceSize, target = targetSize;
+    for (int i = 0; i < targetSize; ++i) {
+        int64_t start = i * source, end = (i + 1) * source;
+        int firstPixel = static_cast<int>(start / target);
+        int lastPixel = static_cast<int>((end - 1) / target);
+        result.first[i] = firstPixel;
+        result.offsets[i] = result.weights.size();
+        int64_t covered = 0;
+        uint32_t assigned = 0;
+        for (int j = firstPixel; j <= lastPixel; ++j) {
+            covered += min((j + 1) * target, end) - max(j * target, start);
+            uint32_t total = static_cast<uint32_t>(((covered << WEIGHT_BITS) + source / 2) / source);
+            result.weights.push_back(total - assigned);
+            assigned = total;
+        }
+    }
+    result.offsets[targetSize] = result.weights.size();
+    return result;
+}
+
+/**
+ * @brief Reduce una fila de origen a lo ancho, en punto fijo con 8 bits fraccionarios.
+ * @tparam Channels Cantidad de canales conocida al compilar (0 si se usa runtimeChannels).
+ */
+template <int Channels>
+static void resizeRow(const uint8_t* __restrict source, uint16_t* __restrict target, const AreaWeights& weights,
+                      int targetWidth, int runtimeChannels) {
+    const int channels = Channels > 0 ? Channels : runtimeChannels;
+    for (int x = 0; x < targetWidth; ++x) {
+        const uint8_t* pixels = source + static_cast<size_t>(weights.first[x]) * channels;
+        const uint32_t* w = weights.of(x);
+        int count = weights.count(x);
+        for (int c = 0; c < channels; ++c) {
+            uint32_t sum = 0;
+            for (int k = 0; k < count; ++k) sum += w[k] * pixels[k * channels + c];
+            // El máximo es 255 * 2^16: entra en 32 bits, y en 16 después de descartar 8 bits
+            target[x * channels + c] = static_cast<uint16_t>((sum + (1 << 7)) >> 8);
+        }
+    }
+}
+
+void resizeArea(const function<const uint8_t*(int y)>& sourceRow, int sourceWidth, int sourceHeight,
+                const function<uint8_t*(int y)>& targetRow, int targetWidth, int targetHeight,
+                int channels, int threads) {
+    if (sourceWidth <= 0 || sourceHeight <= 0 || targetWidth <= 0 || targetHeight <= 0) return;
+    AreaWeights columns = areaWeights(sourceWidth, targetWidth);
+    AreaWeights rows = areaWeights(sourceHeight, targetHeight);
+    size_t values = static_cast<size_t>(targetWidth) * channels;
+
+    // Cada fila de destino lee unas sourceHeight / targetHeight filas de origen
+    int64_t work = static_cast<int64_t>(sourceWidth) * (sourceHeight / targetHeight + 1);
+    int grain = static_cast<int>(max<int64_t>(1, 16384 / work));
+    threadPool().parallelFor(threads, 0, targetHeight, grain, [&](int yStart, int yEnd) {
+        vector<uint16_t> reduced(values);
+        vector<uint32_t> sums(values);
+        // Dos filas de destino seguidas suelen compartir una fila de origen: no se reduce dos veces
+        int reducedRow = -1;
+        for (int y = yStart; y < yEnd; ++y) {
+            const uint32_t* w = rows.of(y);
+            int count = rows.count(y);
+            fill(sums.begin(), sums.end(), 0);
+            for (int k = 0; k < count; ++k) {
+                int row = rows.first[y] + k;
+                if (row != reducedRow) {
+                    if (channels == 3) {
+                        resizeRow<3>(sourceRow(row), reduced.data(), columns, targetWidth, channels);
+                    } else {
+                        resizeRow<0>(sourceRow(row), reduced.data(), columns, targetWidth, channels);
+                    }
+                    reducedRow = row;
+                }
+                // 2^16 * (255 * 2^8) + 2^23 entra en 32 bits; el compilador vectoriza este bucle
+                uint32_t weight = w[k];
+                const uint16_t* __restrict in = reduced.data();
+                uint32_t* __restrict out = sums.data();
+                for (size_t i = 0; i < values; ++i) out[i] += weight * in[i];
+            }
+            uint8_t* pixels = targetRow(y);
+            for (size_t i = 0; i < values; ++i) {
+                pixels[i] = static_cast<uint8_t>((sums[i] + (1u << 23)) >> 24);
+            }
+        }
+    });
+}
@@ -0,0 +1,46 @@
+#ifndef RESIZE_H
+#define RESIZE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Interpreta el tamaño pedido por un filtro resize (params[0] = ancho, params[1] = alto).
+ * @param width, height El tamaño actual de la imagen.
+ * @return El tamaño nuevo. Si el alto falta o es 0 (o el ancho es 0), se calcula para mantener la
+ * proporción de la imagen.
+ * @throws invalid_argument Si falta el ancho, algún valor es negativo o los dos son 0.
+ */
+pair<int, int> resizeTarget(const vector<string>& params, int width, int height);
+
+/**
+ * @brief Interpreta el tamaño pedido por un filtro scale (params[0] = factor, puede tener decimales).
+ * @return El tamaño actual multiplicado por el factor y redondeado, de al menos 1 x 1.
+ * @throws invalid_argument Si falta el factor, no es positivo o el resultado es demasiado grande.
+ */
+pair<int, int> scaleTarget(const vector<string>& params, int width, int height);
+
+/**
+ * @brief Cambia el tamaño de una imagen de canales de bytes intercalados promediando áreas.
+ * @param sourceRow Devuelve el primer byte de la fila y de la imagen de origen.
+ * @param sourceWidth, sourceHeight El tamaño de la imagen de origen.
+ * @param targetRow Devuelve el primer byte de la fila y de la imagen de destino.
+ * @param targetWidth, targetHeight El tamaño de la imagen de destino.
+ * @param channels Cantidad de canales por pixel (3 en BGR).
+ * @param threads Número de threads a utilizar.
+ * @details Cada pixel de destino es el promedio de los píxeles de origen que cubre, pesados por la
+ * fracción de su área que cae dentro (al reducir a la mitad, el promedio de cada bloque de 2 x 2).
+ * Es separable: cada fila de origen se reduce a lo ancho a un buffer en punto fijo y las filas
+ * reducidas se acumulan con sus pesos verticales. Los pesos de cada pixel suman exactamente 1, así
+ * que una imagen de un solo color no cambia. Las filas de destino se reparten entre los threads.
+ */
+void resizeArea(const function<const uint8_t*(int y)>& sourceRow, int sourceWidth, int sourceHeight,
+                const function<uint8_t*(int y)>& targetRow, int targetWidth, int targetHeight,
+                int channels, int threads);
+
+#endif // RESIZE_H
@@ -0,0 +1,254 @@
+#include "server.h"
+#include "pipeline.h"
+#include "../BMPImage.h"
+#include "../utils/queue.h"
+#include "../utils/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ServerJob parseJob(const string& line) {
+    istringstream fields(line);
+    ServerJob job;
+    if (!(fields >> job.inputFile >> job.outputFile)) {
+        throw invalid_argument("Faltan la entrada y la salida");
+    }
+    string arg;
+    while (fields >> arg) job.steps.push_back(parseFilterStep(arg));
+    if (job.steps.empty()) {
+        throw invalid_argument("Faltan los filtros");
+    }
+    // Valida que los filtros existan (y sus parámetros de alcance) antes de encolar el trabajo
+    pipelineHalo(job.steps);
+    return job;
+}
+
+/**
+ * @brief Función que manda la respuesta de un trabajo a quien lo pidió.
+ */
+using Reply = function<void(const string&)>;
+
+/**
+ * @brief Cola de trabajos y los hilos que los procesan, compartidos por todas las conexiones.
+ */
+class JobServer {
+public:
+    JobServer(int threads, int jobs) : queue(max(1, jobs)), threads(threads) {
+        for (int i = 0; i < max(1, jobs); ++i) {
+            runners.emplace_back([this, i] {
+                setTraceThreadName("trabajo " + to_string(i));
+                PendingJob pending;
+                while (queue.pop(pending)) {
+                    pending.reply(run(pending.job));
+                    pending = PendingJob();
+                }
+            });
+        }
+    }
+
+    ~JobServer() { finish(); }
+
+    /**
+     * @brief Interpreta una línea y, si es un trabajo, lo encola (esperando si la cola está llena).
+     * @return False si la línea pide terminar el servidor.
+     */
+    bool submit(const string& line, const Reply& reply) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#') return true;
+        string command = line.substr(start, line.find_last_not_of(" \t\r") - start + 1);
+        if (command == "shutdown") return false;
+        PendingJob pending;
+        try {
+            pending.job = parseJob(command);
+        } catch (const exception& e) {
+            reply(string("error - ") + e.what());
+            return true;
+        }
+        pending.reply = reply;
+        queue.push(move(pending));
+        return true;
+    }
+
+    /**
+     * @brief Deja de aceptar trabajos y espera a que terminen los encolados.
+     */
+    void finish() {
+        queue.close();
+        for (auto& runner : runners) {
+            if (runner.joinable()) runner.join();
+        }
+    }
+
+private:
+    struct PendingJob {
+        ServerJob job;
+        Reply reply;
+    };
+
+    string run(const ServerJob& job) {
+        auto start = chrono::steady_clock::now();
+        try {
+            BmpImage img;
+            if (!img.load(job.inputFile, LoadMode::Map)) {
+                return "error " + job.outputFile + " No se pudo cargar la imagen " + job.inputFile;
+            }
+            applyPipelineFused(img, job.steps, threads);
+            if (!img.save(job.outputFile)) {
+                return "error " + job.outputFile + " No se pudo guardar la imagen";
+            }
+        } catch (const exception& e) {
+            return "error " + job.outputFile + " " + e.what();
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        return "ok " + job.outputFile + " " + to_string(elapsed.count());
+    }
+
+    BoundedQueue<PendingJob> queue;
+    vector<thread> runners;
+    int threads;
+};
+
+void serveStream(istream& in, ostream& out, int threads, int jobs) {
+    mutex outMutex;
+    Reply reply = [&](const string& response) {
+        lock_guard<mutex> lock(outMutex);
+        out << response << endl;
+    };
+    JobServer server(threads, jobs);
+    string line;
+    while (getline(in, line) && server.submit(line, reply)) {
+    }
+    server.finish();
+}
+
+/**
+ * @brief Una conexión al socket. Se cierra cuando ya no la usan ni su hilo ni sus trabajos pendientes.
+ */
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+
+    void send(const string& response) {
+        lock_guard<mutex> lock(writeMutex);
+        string data = response + "\n";
+        size_t written = 0;
+        while (written < data.size()) {
+            // MSG_NOSIGNAL: si el cliente ya se fue, la respuesta se descarta sin SIGPIPE
+            ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            written += n;
+        }
+    }
+
+    int fd;
+    mutex writeMutex;
+};
+
+bool serveSocket(const string& path, int threads, int jobs) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        cerr << "Ruta de socket inválida: " << path << "\n";
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) return false;
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        cerr << "No se pudo escuchar en " << path << ": " << strerror(errno) << "\n";
+        close(listener);
+        return false;
+    }
+
+    JobServer server(threads, jobs);
+    atomic<bool> stopping{false};
+    mutex connectionsMutex;
+    set<int> openConnections;
+    // Hilos de las conexiones abiertas, y los de las que ya terminaron y falta esperar. Los clientes
+    // suelen conectarse una vez por trabajo, así que los terminados se esperan antes de aceptar cada
+    // conexión nueva en lugar de al cerrar el servidor
+    map<int, thread> handlers;
+    vector<int> finishedHandlers;
+    int nextHandler = 0;
+    auto reapHandlers = [&] {
+        vector<thread> finished;
+        {
+            lock_guard<mutex> lock(connectionsMutex);
+            for (int id : finishedHandlers) {
+                finished.push_back(move(handlers[id]));
+                handlers.erase(id);
+            }
+            finishedHandlers.clear();
+        }
+        for (auto& handler : finished) handler.join();
+    };
+
+    // Al pedir shutdown se cortan la espera de conexiones nuevas y la lectura de las abiertas
+    auto stop = [&] {
+        if (stopping.exchange(true)) return;
+        shutdown(listener, SHUT_RDWR);
+        lock_guard<mutex> lock(connectionsMutex);
+        for (int fd : openConnections) shutdown(fd, SHUT_RD);
+    };
+
+    while (!stopping) {
+        reapHandlers();
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto connection = make_shared<Connection>(fd);
+        lock_guard<mutex> lock(connectionsMutex);
+        if (stopping) break;
+        openConnections.insert(fd);
+        int id = nextHandler++;
+        handlers[id] = thread([&, connection, id] {
+            Reply reply = [connection](const string& response) { connection->send(response); };
+            string pending;
+            char buffer[4096];
+            bool open = true;
+            while (open) {
+                ssize_t n = recv(connection->fd, buffer, sizeof(buffer), 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                pending.append(buffer, n);
+                size_t newline;
+                while (open && (newline = pending.find('\n')) != string::npos) {
+                    string line = pending.substr(0, newline);
+                    pending.erase(0, newline + 1);
+                    if (!server.submit(line, reply)) {
+                        open = false;
+                        stop();
+                    }
+                }
+            }
+            lock_guard<mutex> lock(connectionsMutex);
+            openConnections.erase(connection->fd);
+            finishedHandlers.push_back(id);
+        });
+    }
+
+    stop();
+    reapHandlers();
+    for (auto& [id, handler] : handlers) handler.join();
+    server.finish();
+    close(listener);
+    unlink(path.c_str());
+    return true;
+}
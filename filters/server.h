@@ -0,0 +1,55 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "../utils/utils.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Un trabajo del modo servidor: aplicar un pipeline a una imagen.
+ */
+struct ServerJob {
+    string inputFile;
+    string outputFile;
+    vector<FilterStep> steps;
+};
+
+/**
+ * @brief Interpreta una línea de trabajo: `<entrada.bmp> <salida.bmp> <filtro1:p1,...> [<filtro2> ...]`.
+ * @details Los campos van separados por espacios y los filtros tienen el mismo formato que en la
+ * línea de comandos (ver parseFilterStep).
+ * @throws invalid_argument Si faltan la entrada, la salida o los filtros.
+ * @throws runtime_error Si algún filtro no está registrado.
+ */
+ServerJob parseJob(const string& line);
+
+/**
+ * @brief Atiende trabajos que llegan por un stream (por ejemplo, la entrada estándar), uno por línea.
+ * @param in De donde se leen los trabajos (ver parseJob). Las líneas vacías o que empiezan con '#'
+ * se ignoran, y la línea `shutdown` termina el servidor.
+ * @param out Donde se escribe una línea por trabajo: `ok <salida> <milisegundos>` o
+ * `error <salida> <motivo>` (con `-` como salida si la línea no se pudo interpretar). Como los
+ * trabajos corren a la vez, las respuestas pueden llegar en otro orden que los pedidos.
+ * @param threads Número de threads de cada trabajo (puede ser AUTO_THREADS).
+ * @param jobs Cantidad máxima de trabajos que se procesan a la vez.
+ * @details Los filtros, el pool de hilos y los pools de buffers quedan inicializados entre trabajos,
+ * así que una imagen chica sólo paga su lectura, sus filtros y su escritura. Los trabajos pasan por
+ * una cola acotada: si hay `jobs` trabajos corriendo y otros tantos esperando, se deja de leer
+ * hasta que alguno termine. Vuelve cuando terminaron todos los trabajos recibidos.
+ */
+void serveStream(istream& in, ostream& out, int threads, int jobs);
+
+/**
+ * @brief Atiende trabajos que llegan por un socket Unix, con el mismo protocolo que serveStream.
+ * @param path Ruta del socket. Si ya existe un archivo ahí, se reemplaza.
+ * @details Cada conexión puede mandar varios trabajos y recibe las respuestas de los suyos. Todas
+ * las conexiones comparten la misma cola acotada. Una línea `shutdown` en cualquier conexión cierra
+ * el socket; el servidor vuelve cuando terminaron los trabajos pendientes.
+ * @return False si no se pudo crear el socket.
+ */
+bool serveSocket(const string& path, int threads, int jobs);
+
+#endif // SERVER_H
@@ -0,0 +1,244 @@
+#include "simd.h"
+#include "pixelmath.h"
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// Las versiones vectoriales se compilan con atributos target, así que no hace falta compilar todo el
+// programa con -mavx2: se elige la mejor versión en tiempo de ejecución según lo que soporte la CPU.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/* ----------------- Versiones escalares (y colas de las vectoriales) ----------------- */
+
+inline uint8_t grayOf(const uint8_t* pixel) {
+    return luminance(pixel[0], pixel[1], pixel[2]);
+}
+
+void negateScalar(uint8_t* data, int pixels) {
+    for (int i = 0; i < pixels * 3; ++i) {
+        data[i] = 255 - data[i];
+    }
+}
+
+// step = 256 / niveles; con step = 1 es la escala de grises común
+void quantizedGrayScalar(uint8_t* data, int pixels, int step) {
+    for (int i = 0; i < pixels; ++i) {
+        uint8_t* pixel = data + i * 3;
+        uint8_t gray = static_cast<uint8_t>(grayOf(pixel) / step * step);
+        pixel[0] = pixel[1] = pixel[2] = gray;
+    }
+}
+
+#ifdef SIMD_X86
+
+/* ----------------- SSE2 / AVX2: negativo (byte a byte) ----------------- */
+
+__attribute__((target("sse2")))
+void negateSSE2(uint8_t* data, int pixels) {
+    int bytes = pixels * 3, i = 0;
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, ones));
+    }
+    for (; i < bytes; ++i) data[i] = 255 - data[i];
+}
+
+__attribute__((target("avx2")))
+void negateAVX2(uint8_t* data, int pixels) {
+    int bytes = pixels * 3, i = 0;
+    const __m256i ones = _mm256_set1_epi8(-1);
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, ones));
+    }
+    for (; i < bytes; ++i) data[i] = 255 - data[i];
+}
+
+/* ----------------- SSSE3 / AVX2: grises (16 píxeles = 48 bytes por bloque) ----------------- */
+
+// Máscaras de pshufb para separar los canales de 48 bytes BGR cargados en 3 registros (v0, v1, v2):
+// el canal c del píxel i está en el byte 3i + c. -1 pone el byte en cero.
+#define BLUE_MASKS  _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)
+#define GREEN_MASKS _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)
+#define RED_MASKS   _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1), \
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)
+// Máscaras para repetir cada gris 3 veces y volver a armar los 48 bytes
+#define REPEAT_MASKS _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5), \
+                     _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10), \
+                     _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15)
+
+// Multiplicador para dividir por step con mulhi: (g * m) >> 16 == g / step para todo g < 256
+inline int16_t reciprocal(int step) {
+    return static_cast<int16_t>(step > 1 ? (65536 + step - 1) / step : 0);
+}
+
+// Luminancia (y cuantización, si step > 1) de 8 píxeles con canales de 16 bits
+__attribute__((target("sse2")))
+inline __m128i gray16SSE(int step, __m128i b, __m128i g, __m128i r) {
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(29)), _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+    sum = _mm_add_epi16(_mm_add_epi16(sum, _mm_mullo_epi16(r, _mm_set1_epi16(77))), _mm_set1_epi16(128));
+    sum = _mm_srli_epi16(sum, 8);
+    if (step > 1) {
+        sum = _mm_mullo_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(reciprocal(step))), _mm_set1_epi16(static_cast<int16_t>(step)));
+    }
+    return sum;
+}
+
+__attribute__((target("ssse3")))
+void quantizedGraySSSE3(uint8_t* data, int pixels, int step) {
+    const __m128i blue[3] = { BLUE_MASKS };
+    const __m128i green[3] = { GREEN_MASKS };
+    const __m128i red[3] = { RED_MASKS };
+    const __m128i repeat[3] = { REPEAT_MASKS };
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8_t* p = data + i * 3;
+        __m128i v[3];
+        for (int k = 0; k < 3; ++k) v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        __m128i b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], blue[0]), _mm_shuffle_epi8(v[1], blue[1])), _mm_shuffle_epi8(v[2], blue[2]));
+        __m128i g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], green[0]), _mm_shuffle_epi8(v[1], green[1])), _mm_shuffle_epi8(v[2], green[2]));
+        __m128i r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], red[0]), _mm_shuffle_epi8(v[1], red[1])), _mm_shuffle_epi8(v[2], red[2]));
+
+        __m128i low = gray16SSE(step, _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero));
+        __m128i high = gray16SSE(step, _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero));
+        __m128i gray = _mm_packus_epi16(low, high);
+
+        for (int k = 0; k < 3; ++k) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16 * k), _mm_shuffle_epi8(gray, repeat[k]));
+        }
+    }
+    quantizedGrayScalar(data + i * 3, pixels - i, step);
+}
+
+__attribute__((target("avx2")))
+inline __m256i gray16AVX2(int step, __m256i b, __m256i g, __m256i r) {
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(29)), _mm256_mullo_epi16(g, _mm256_set1_epi16(150)));
+    sum = _mm256_add_epi16(_mm256_add_epi16(sum, _mm256_mullo_epi16(r, _mm256_set1_epi16(77))), _mm256_set1_epi16(128));
+    sum = _mm256_srli_epi16(sum, 8);
+    if (step > 1) {
+        sum = _mm256_mullo_epi16(_mm256_mulhi_epu16(sum, _mm256_set1_epi16(reciprocal(step))), _mm256_set1_epi16(static_cast<int16_t>(step)));
+    }
+    return sum;
+}
+
+// Igual que la versión SSSE3, pero cada mitad del registro de 256 bits procesa un bloque de 16
+// píxeles distinto (pshufb trabaja por mitades), así que se avanza de a 32 píxeles.
+__attribute__((target("avx2")))
+void quantizedGrayAVX2(uint8_t* data, int pixels, int step) {
+    const __m128i blue128[3] = { BLUE_MASKS };
+    const __m128i green128[3] = { GREEN_MASKS };
+    const __m128i red128[3] = { RED_MASKS };
+    const __m128i repeat128[3] = { REPEAT_MASKS };
+    __m256i blue[3], green[3], red[3], repeat[3];
+    for (int k = 0; k < 3; ++k) {
+        blue[k] = _mm256_broadcastsi128_si256(blue128[k]);
+        green[k] = _mm256_broadcastsi128_si256(green128[k]);
+        red[k] = _mm256_broadcastsi128_si256(red128[k]);
+        repeat[k] = _mm256_broadcastsi128_si256(repeat128[k]);
+    }
+    const __m256i zero = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 32 <= pixels; i += 32) {
+        uint8_t* p = data + i * 3;
+        __m256i v[3];
+        for (int k = 0; k < 3; ++k) {
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48 + 16 * k));
+            v[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+        __m256i b = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], blue[0]), _mm256_shuffle_epi8(v[1], blue[1])), _mm256_shuffle_epi8(v[2], blue[2]));
+        __m256i g = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], green[0]), _mm256_shuffle_epi8(v[1], green[1])), _mm256_shuffle_epi8(v[2], green[2]));
+        __m256i r = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], red[0]), _mm256_shuffle_epi8(v[1], red[1])), _mm256_shuffle_epi8(v[2], red[2]));
+
+        // unpack y pack trabajan por mitades, así que el orden de los píxeles se conserva
+        __m256i low = gray16AVX2(step, _mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(g, zero), _mm256_unpacklo_epi8(r, zero));
+        __m256i high = gray16AVX2(step, _mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(g, zero), _mm256_unpackhi_epi8(r, zero));
+        __m256i gray = _mm256_packus_epi16(low, high);
+
+        for (int k = 0; k < 3; ++k) {
+            __m256i out = _mm256_shuffle_epi8(gray, repeat[k]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16 * k), _mm256_castsi256_si128(out));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 48 + 16 * k), _mm256_extracti128_si256(out, 1));
+        }
+    }
+    quantizedGrayScalar(data + i * 3, pixels - i, step);
+}
+
+#endif // SIMD_X86
+
+SimdLevel detectSimdLevel() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return SimdLevel::SSSE3;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+atomic<SimdLevel> simdLimit{SimdLevel::AVX2};
+
+void quantizedGrayRow(uint8_t* data, int pixels, int step) {
+    switch (simdLevel()) {
+#ifdef SIMD_X86
+        case SimdLevel::AVX2:
+            quantizedGrayAVX2(data, pixels, step);
+            return;
+        case SimdLevel::SSSE3:
+            quantizedGraySSSE3(data, pixels, step);
+            return;
+#endif
+        default:
+            quantizedGrayScalar(data, pixels, step);
+    }
+}
+
+} // namespace
+
+SimdLevel simdLevel() {
+    static const SimdLevel detected = detectSimdLevel();
+    return min(detected, simdLimit.load());
+}
+
+void limitSimdLevel(SimdLevel level) {
+    simdLimit = level;
+}
+
+void negateRow(uint8_t* data, int pixels) {
+    switch (simdLevel()) {
+#ifdef SIMD_X86
+        case SimdLevel::AVX2:
+            negateAVX2(data, pixels);
+            return;
+        case SimdLevel::SSSE3:
+        case SimdLevel::SSE2:
+            negateSSE2(data, pixels);
+            return;
+#endif
+        default:
+            negateScalar(data, pixels);
+    }
+}
+
+void grayscaleRow(uint8_t* data, int pixels) {
+    quantizedGrayRow(data, pixels, 1);
+}
+
+void thresholdRow(uint8_t* data, int pixels, int levels) {
+    quantizedGrayRow(data, pixels, 256 / levels);
+}
@@ -0,0 +1,53 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstdint>
+
+/**
+ * @brief Conjuntos de instrucciones vectoriales que pueden usar los filtros punto a punto.
+ * @details Están ordenados: cada nivel incluye a los anteriores.
+ */
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    SSSE3,
+    AVX2
+};
+
+/**
+ * @brief Obtiene el nivel SIMD que se está usando.
+ * @return El mejor nivel soportado por la CPU (consultado con CPUID la primera vez), salvo que se
+ * haya limitado con limitSimdLevel.
+ */
+SimdLevel simdLevel();
+
+/**
+ * @brief Limita el nivel SIMD a usar (por ejemplo, para comparar contra la versión escalar).
+ * @param level Nivel máximo. Si la CPU no lo soporta, se usa el mejor que sí soporte.
+ */
+void limitSimdLevel(SimdLevel level);
+
+/**
+ * @brief Invierte los colores de una tira de píxeles BGR empaquetados (24 bits).
+ * @param data Puntero al primer byte del primer píxel.
+ * @param pixels Cantidad de píxeles.
+ */
+void negateRow(uint8_t* data, int pixels);
+
+/**
+ * @brief Convierte a escala de grises una tira de píxeles BGR empaquetados (24 bits).
+ * @param data Puntero al primer byte del primer píxel.
+ * @param pixels Cantidad de píxeles.
+ * @details Usa la luminancia en punto fijo (77 * r + 150 * g + 29 * b + 128) / 256.
+ */
+void grayscaleRow(uint8_t* data, int pixels);
+
+/**
+ * @brief Convierte a una cantidad fija de grises una tira de píxeles BGR empaquetados (24 bits).
+ * @param data Puntero al primer byte del primer píxel.
+ * @param pixels Cantidad de píxeles.
+ * @param levels Cantidad de niveles de gris (entre 1 y 256).
+ */
+void thresholdRow(uint8_t* data, int pixels, int levels);
+
+#endif // SIMD_H
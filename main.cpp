@@ -1,22 +1,85 @@
 #include "utils/utils.h"
 #include "filters/filters.h"
+#include "filters/pipeline.h"
+#include "filters/batch.h"
+#include "filters/autotune.h"
+#include "filters/server.h"
+#include "utils/bufferpool.h"
+#include "utils/threadpool.h"
+#include "utils/trace.h"
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <chrono>
+#include <thread>
 
 using namespace std;
 
 int main(int argc, char* argv[]) {
     // Comprobar si se pasaron argumentos
     if (argc < 4) {
-        cerr << "Uso: " << argv[0] << " <entrada.bmp> <salida.bmp> <threads> <filtro1:p1?,p2?,...> [<filtro2:p1?,p2?> ...]\n";
+        cerr << "Uso: " << argv[0] << " <entrada.bmp> <salida.bmp> <threads> <filtro1:p1?,p2?,...> [<filtro2:p1?,p2?> ...] [opciones]\n";
+        cerr << "     " << argv[0] << " --serve <socket|-> <threads> [--jobs=<n>] [opciones]\n";
+        cerr << "   Con --serve atiende trabajos \"<entrada.bmp> <salida.bmp> <filtro1> ...\", uno por línea, por un socket\n";
+        cerr << "   Unix o por la entrada estándar (-), con los hilos y los buffers listos entre trabajos\n";
+        cerr << "   <threads> puede ser \"auto\": cada paso usa los hilos que más le convienen según el tamaño de la\n";
+        cerr << "   imagen y una calibración que se mide una sola vez por máquina\n";
+        cerr << "Opciones:\n";
+        cerr << "   --strip=<filas>   Procesa la imagen por franjas de <filas> filas, sin cargarla completa en memoria\n";
+        cerr << "   --batch           <entrada> es un directorio (o una lista de archivos) y <salida> el directorio de salida\n";
+        cerr << "   --planar          Separa los canales en planos durante todo el pipeline (mejor para pipelines largos)\n";
+        cerr << "   --profile         Muestra cuánto tardó cada etapa y filtro, y cuánto trabajó cada hilo\n";
+        cerr << "   --trace=<archivo> Guarda los tiempos en formato Chrome trace-event (chrome://tracing)\n";
+        cerr << "   --hugepages       Usa páginas enormes transparentes para los buffers grandes\n";
+        cerr << "   --calibration=<archivo> Archivo donde se guarda la calibración de threads=auto\n";
+        cerr << "   --pin             Fija cada hilo a un núcleo y reparte entre los hilos la primera escritura de las imágenes (NUMA)\n";
         return 1;
     }
 
     string inputFile = argv[1];
     string outputFile = argv[2];
-    int threads = stoi(argv[3]);
+    int threads = string(argv[3]) == "auto" ? AUTO_THREADS : stoi(argv[3]);
     vector<FilterStep> steps = parsePipeline(argc, argv);
+    map<string, string> options = parseOptions(argc, argv);
+    // Con threads=auto el pool tiene un hilo por núcleo y cada paso elige cuántos usa
+    int poolThreads = threads == AUTO_THREADS ? static_cast<int>(thread::hardware_concurrency()) : threads;
+    if (options.count("calibration")) setCalibrationFile(options["calibration"]);
+    // Con threads=auto, los filtros que falten se calibran antes de empezar, con el pool libre
+    auto calibrate = [&](const vector<FilterStep>& calibrated) {
+        if (threads == AUTO_THREADS) calibrateSteps(calibrated, threadPool().size());
+    };
+
+    // Activar la medición antes de crear el pool, así los hilos quedan registrados con su nombre
+    enableTracing(options.count("profile") || options.count("trace"));
+    enableHugePages(options.count("hugepages"));
+    auto reportTrace = [&]() {
+        if (options.count("profile")) {
+            cout << "\n";
+            printTraceSummary(cout);
+        }
+        if (options.count("trace") && !writeTrace(options["trace"])) {
+            cerr << "No se pudo guardar la traza en " << options["trace"] << "\n";
+        }
+    };
+
+    if (inputFile == "--serve") {
+        int jobs = options.count("jobs") ? stoi(options["jobs"]) : max(1, poolThreads);
+        registerFilters();
+        initThreadPool(poolThreads, options.count("pin"));
+        // Los trabajos pueden pedir cualquier filtro: se calibran todos
+        calibrate(calibrationSamples());
+        bool served = true;
+        if (outputFile == "-") {
+            serveStream(cin, cout, threads, jobs);
+        } else {
+            cerr << "Atendiendo trabajos en " << outputFile << "\n";
+            served = serveSocket(outputFile, threads, jobs);
+        }
+        reportTrace();
+        releaseFilterBuffers();
+        releaseBufferPool();
+        return served ? 0 : 1;
+    }
 
     // Imprimir los pasos del pipeline
     for (const auto& step : steps) {
@@ -30,30 +93,107 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    BmpImage img;
-    if (!img.load(inputFile)) {
-        cerr << "No se pudo cargar la imagen.\n";
-        return 1;
+    if (options.count("batch")) {
+        registerFilters();
+        initThreadPool(poolThreads, options.count("pin"));
+        calibrate(steps);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        BatchStats stats;
+        try {
+            stats = applyPipelineBatch(listBatchInputs(inputFile), outputFile, steps, threads);
+        } catch (const exception& e) {
+            cerr << "Error aplicando el pipeline: " << e.what() << "\n";
+            return 1;
+        }
+        releaseFilterBuffers();
+        releaseBufferPool();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        cout << "Imagenes procesadas: " << stats.processed << " (con errores: " << stats.failed << ")\n";
+        cout << "Tiempo de procesamiento (incluye lectura y escritura): " << elapsed.count() << " segundos" << endl;
+        reportTrace();
+        return stats.failed == 0 ? 0 : 1;
+    }
+
+    if (options.count("strip")) {
+        registerFilters();
+        initThreadPool(poolThreads, options.count("pin"));
+        calibrate(steps);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        try {
+            if (!applyPipelineInStrips(inputFile, outputFile, steps, threads, stoi(options["strip"]))) {
+                cerr << "No se pudo procesar la imagen por franjas.\n";
+                return 1;
+            }
+        } catch (const exception& e) {
+            cerr << "Error aplicando el pipeline: " << e.what() << "\n";
+            return 1;
+        }
+        releaseFilterBuffers();
+        releaseBufferPool();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        cout << "Tiempo de procesamiento (incluye lectura y escritura): " << elapsed.count() << " segundos" << endl;
+        reportTrace();
+        return 0;
     }
 
     // Registrar todos los filtros disponibles
     registerFilters();
 
+    // Crear una sola vez los hilos que van a compartir todos los filtros (antes de cargar la imagen:
+    // con --pin, las páginas de las imágenes se reparten entre los nodos de los hilos)
+    initThreadPool(poolThreads, options.count("pin"));
+    calibrate(steps);
+
+    BmpImage img;
+    // Los píxeles se mapean desde el archivo: sólo se copian las páginas que los filtros modifican
+    bool loaded;
+    {
+        TraceScope trace("etapa", "lectura");
+        loaded = img.load(inputFile, LoadMode::Map);
+    }
+    if (!loaded) {
+        cerr << "No se pudo cargar la imagen.\n";
+        return 1;
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
 
-    for (const auto& step : steps) {
-        try {
-            applyFilter(img, step.name, step.parameters, threads);
-        } catch (const exception& e) {
-            cerr << "Error aplicando el filtro " << step.name << ": " << e.what() << "\n";
-            return 1;
+    // Todos los filtros se aplican bloque por bloque, con una sola pasada por la imagen (o, con
+    // --planar, sobre los canales separados)
+    try {
+        if (options.count("planar")) {
+            applyPipelinePlanar(img, steps, threads);
+        } else {
+            applyPipelineFused(img, steps, threads);
         }
+    } catch (const exception& e) {
+        cerr << "Error aplicando el pipeline: " << e.what() << "\n";
+        return 1;
     }
 
+    // Los buffers auxiliares de los filtros (y los que guarda el pool) ya no hacen falta
+    releaseFilterBuffers();
+    releaseBufferPool();
+
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
     cout << "Tiempo de procesamiento: " << elapsed.count() << " segundos" << endl;
 
-    img.save(outputFile);
+    bool saved;
+    {
+        TraceScope trace("etapa", "escritura");
+        saved = img.save(outputFile);
+    }
+    reportTrace();
+    if (!saved) {
+        cerr << "No se pudo guardar la imagen.\n";
+        return 1;
+    }
     return 0;
 }
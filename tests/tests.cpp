@@ -5,9 +5,34 @@
 #include <filesystem>
 #include <cmath>
 #include <chrono>
+#include <atomic>
+#include <array>
+#include <set>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 #include "../BMPImage.h"
 #include "../filters/filters.h"
+#include "../filters/gaussian.h"
+#include "../filters/histogram.h"
+#include "../filters/integral.h"
+#include "../filters/simd.h"
+#include "../filters/pipeline.h"
+#include "../filters/resize.h"
+#include "../filters/batch.h"
+#include "../filters/autotune.h"
+#include "../filters/server.h"
 #include "../utils/utils.h"
+#include "../utils/bufferpool.h"
+#include "../utils/threadpool.h"
+#include "../utils/trace.h"
 
 using namespace std;
 
@@ -101,6 +126,255 @@ TEST_F(BmpImageTest, InvalidSectionDimensions) {
     EXPECT_THROW(testImage.getSection(0, 0, -1, 1), invalid_argument);
 }
 
+TEST_F(BmpImageTest, RowViewsShareData) {
+    BmpImage img;
+    img.create(5, 3); // 15 bytes por fila + 1 de padding
+    span<RGB> row = img.getRow(1);
+    EXPECT_EQ(row.size(), 5);
+    row[2] = {1, 2, 3};
+    RGB pixel = img.getPixel(2, 1);
+    EXPECT_EQ(pixel.blue, 1);
+    EXPECT_EQ(pixel.green, 2);
+    EXPECT_EQ(pixel.red, 3);
+}
+
+TEST_F(BmpImageTest, RectangularViews) {
+    BmpImage img;
+    img.create(7, 5);
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 7; ++x) {
+            img.setPixel(x, y, { static_cast<uint8_t>(x), static_cast<uint8_t>(y), 0 });
+        }
+    }
+
+    ConstImageView section = static_cast<const BmpImage&>(img).view(2, 1, 4, 3);
+    EXPECT_EQ(section.getWidth(), 4);
+    EXPECT_EQ(section.getHeight(), 3);
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_EQ(section(i, j).blue, 2 + i);
+            EXPECT_EQ(section(i, j).green, 1 + j);
+        }
+    }
+
+    img.view(6, 4, 1, 1)(0, 0).red = 9;
+    EXPECT_EQ(img.getPixel(6, 4).red, 9);
+
+    EXPECT_THROW(img.view(5, 0, 3, 1), invalid_argument);
+    EXPECT_THROW(img.view(0, -1, 1, 1), invalid_argument);
+}
+
+TEST_F(BmpImageTest, SectionMatchesPixels) {
+    BmpImage img;
+    img.create(6, 4);
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 6; ++x) {
+            img.setPixel(x, y, { static_cast<uint8_t>(x * 10 + y), 0, 0 });
+        }
+    }
+    vector<RGB> section = img.getSection(1, 1, 4, 3);
+    ASSERT_EQ(section.size(), 6);
+    for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_EQ(section[j * 3 + i].blue, img.getPixel(1 + i, 1 + j).blue);
+        }
+    }
+
+    for (RGB& pixel : section) pixel.red = 200;
+    img.setSection(1, 1, section, 4, 3);
+    EXPECT_EQ(img.getPixel(3, 2).red, 200);
+    EXPECT_EQ(img.getPixel(4, 2).red, 0);
+}
+
+TEST_F(BmpImageTest, SaveRoundTripWithPadding) {
+    BmpImage img;
+    img.create(5, 3); // 15 bytes por fila + 1 de padding
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 5; ++x) {
+            img.setPixel(x, y, { static_cast<uint8_t>(x), static_cast<uint8_t>(y), 77 });
+        }
+    }
+    ASSERT_TRUE(img.save("test_output.bmp"));
+    EXPECT_EQ(filesystem::file_size("test_output.bmp"), 54 + 16 * 3);
+
+    BmpImage loaded;
+    ASSERT_TRUE(loaded.load("test_output.bmp"));
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 5; ++x) {
+            RGB pixel = loaded.getPixel(x, y);
+            EXPECT_EQ(pixel.blue, x);
+            EXPECT_EQ(pixel.green, y);
+            EXPECT_EQ(pixel.red, 77);
+        }
+    }
+}
+
+TEST_F(BmpImageTest, MappedLoad) {
+    BmpImage img;
+    img.create(7, 4);
+    img.setPixel(3, 2, {10, 20, 30});
+    ASSERT_TRUE(img.save("test_output.bmp"));
+
+    BmpImage mapped;
+    ASSERT_TRUE(mapped.load("test_output.bmp", LoadMode::Map));
+    EXPECT_EQ(mapped.getWidth(), 7);
+    EXPECT_EQ(mapped.getPixel(3, 2).red, 30);
+
+    // Los cambios quedan en la copia privada: el archivo no se modifica hasta guardar
+    mapped.setPixel(3, 2, {1, 2, 3});
+    BmpImage reread;
+    ASSERT_TRUE(reread.load("test_output.bmp"));
+    EXPECT_EQ(reread.getPixel(3, 2).red, 30);
+
+    // Guardar sobre el mismo archivo mapeado
+    ASSERT_TRUE(mapped.save("test_output.bmp"));
+    EXPECT_EQ(mapped.getPixel(3, 2).red, 3);
+    ASSERT_TRUE(reread.load("test_output.bmp"));
+    EXPECT_EQ(reread.getPixel(3, 2).red, 3);
+
+    // Las copias de una imagen mapeada son independientes
+    BmpImage copy = mapped;
+    copy.setPixel(0, 0, {9, 9, 9});
+    EXPECT_EQ(mapped.getPixel(0, 0).red, 0);
+}
+
+TEST_F(BmpImageTest, SavingOverAnotherMappedImageKeepsItIntact) {
+    // Varias páginas, para que el mapeo tenga páginas que todavía no se leyeron al reemplazar el archivo
+    BmpImage original;
+    original.create(300, 200);
+    for (int y = 0; y < 200; ++y) {
+        for (int x = 0; x < 300; ++x) original.setPixel(x, y, { static_cast<uint8_t>(x), static_cast<uint8_t>(y), 7 });
+    }
+    ASSERT_TRUE(original.save("test_output.bmp"));
+    BmpImage mapped;
+    ASSERT_TRUE(mapped.load("test_output.bmp", LoadMode::Map));
+
+    // Otra imagen (otro trabajo del servidor, por ejemplo) guarda encima del archivo mapeado
+    BmpImage other;
+    other.create(10, 10);
+    ASSERT_TRUE(other.save("test_output.bmp"));
+
+    for (int y = 0; y < 200; ++y) {
+        ASSERT_EQ(memcmp(mapped.getRowData(y), original.getRowData(y), 300 * 3), 0) << "fila " << y;
+    }
+    BmpImage reread;
+    ASSERT_TRUE(reread.load("test_output.bmp"));
+    EXPECT_EQ(reread.getWidth(), 10);
+    // No quedan archivos temporales
+    for (const auto& entry : filesystem::directory_iterator(".")) {
+        EXPECT_EQ(entry.path().filename().string().find("test_output.bmp.tmp"), string::npos);
+    }
+}
+
+TEST_F(BmpImageTest, SavingKeepsLinksAndPermissions) {
+    BmpImage img;
+    img.create(4, 4);
+    ASSERT_TRUE(img.save("test_output.bmp"));
+    filesystem::permissions("test_output.bmp", filesystem::perms::owner_read | filesystem::perms::owner_write);
+    filesystem::remove("test_link.bmp");
+    filesystem::create_symlink("test_output.bmp", "test_link.bmp");
+
+    // Sin mapeos se escribe en el lugar: el enlace sigue siendo un enlace y el archivo, el mismo
+    img.create(6, 6);
+    ASSERT_TRUE(img.save("test_link.bmp"));
+    EXPECT_TRUE(filesystem::is_symlink("test_link.bmp"));
+    BmpImage reread;
+    ASSERT_TRUE(reread.load("test_output.bmp"));
+    EXPECT_EQ(reread.getWidth(), 6);
+
+    // Con el destino mapeado se reemplaza, pero con los mismos permisos
+    BmpImage mapped;
+    ASSERT_TRUE(mapped.load("test_output.bmp", LoadMode::Map));
+    img.create(8, 8);
+    ASSERT_TRUE(img.save("test_output.bmp"));
+    EXPECT_EQ(filesystem::status("test_output.bmp").permissions(),
+              filesystem::perms::owner_read | filesystem::perms::owner_write);
+    EXPECT_EQ(mapped.getWidth(), 6);
+    filesystem::remove("test_link.bmp");
+}
+
+TEST_F(BmpImageTest, LoadsTopDownBgra) {
+    // Un archivo como los de otros programas: 32 bits sin compresión, header de 40 bytes, alto negativo
+    BmpFileHeader fileHeader;
+    fileHeader.offsetData = 54;
+    fileHeader.fileSize = 54 + 2 * 2 * 4;
+    BmpInfoHeader infoHeader;
+    infoHeader.size = 40;
+    infoHeader.width = 2;
+    infoHeader.height = -2;
+    infoHeader.bitCount = 32;
+    const uint8_t pixels[] = { 1, 2, 3, 4,  5, 6, 7, 8,  9, 10, 11, 12,  13, 14, 15, 16 };
+    {
+        ofstream file("test_output.bmp", ios::binary);
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+        file.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+    }
+
+    BmpImage img;
+    ASSERT_TRUE(img.load("test_output.bmp"));
+    EXPECT_EQ(img.getHeight(), 2);
+    EXPECT_EQ(img.getBitCount(), 32);
+    EXPECT_TRUE(img.isTopDown());
+    EXPECT_EQ(img.getPixel(0, 0).blue, 1);
+    EXPECT_EQ(img.getPixel(1, 0).red, 7);
+    EXPECT_EQ(img.getPixel(0, 1).green, 10);
+    EXPECT_EQ(img.getAlphaRow(0)[1], 8);
+    EXPECT_EQ(img.getAlphaRow(1)[1], 16);
+
+    // Se guarda con el mismo formato, byte por byte
+    ASSERT_TRUE(img.save("test_output.bmp"));
+    ifstream file("test_output.bmp", ios::binary);
+    vector<char> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    ASSERT_EQ(bytes.size(), 54 + sizeof(pixels));
+    EXPECT_EQ(memcmp(bytes.data() + 18, &infoHeader.width, 8), 0);
+    EXPECT_EQ(memcmp(bytes.data() + 54, pixels, sizeof(pixels)), 0);
+}
+
+TEST_F(BmpImageTest, FormatsRoundTrip) {
+    for (int bitCount : {24, 32}) {
+        for (bool topDown : {false, true}) {
+            BmpImage img;
+            img.create(5, 3, bitCount, topDown);
+            for (int y = 0; y < 3; ++y) {
+                for (int x = 0; x < 5; ++x) {
+                    img.setPixel(x, y, { static_cast<uint8_t>(x), static_cast<uint8_t>(y), 77 });
+                    if (img.hasAlpha()) img.getAlphaRow(y)[x] = static_cast<uint8_t>(10 * x + y);
+                }
+            }
+            ASSERT_TRUE(img.save("test_output.bmp"));
+            size_t header = bitCount == 32 ? 14 + 108 : 54;
+            EXPECT_EQ(filesystem::file_size("test_output.bmp"), header + (bitCount == 32 ? 20 : 16) * 3);
+
+            BmpImage loaded;
+            ASSERT_TRUE(loaded.load("test_output.bmp", LoadMode::Map));
+            EXPECT_EQ(loaded.getBitCount(), bitCount);
+            EXPECT_EQ(loaded.isTopDown(), topDown);
+            for (int y = 0; y < 3; ++y) {
+                ASSERT_EQ(memcmp(loaded.getRowData(y), img.getRowData(y), 15), 0) << bitCount << " bits, fila " << y;
+                if (bitCount == 32) {
+                    ASSERT_EQ(memcmp(loaded.getAlphaRow(y), img.getAlphaRow(y), 5), 0);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(BmpImageTest, TruncatedFilesFailToLoad) {
+    for (int bitCount : {24, 32}) {
+        for (bool topDown : {false, true}) {
+            BmpImage img;
+            img.create(5, 3, bitCount, topDown);
+            ASSERT_TRUE(img.save("test_output.bmp"));
+            filesystem::resize_file("test_output.bmp", filesystem::file_size("test_output.bmp") - 4);
+
+            BmpImage loaded;
+            EXPECT_FALSE(loaded.load("test_output.bmp")) << bitCount << " bits";
+            EXPECT_FALSE(loaded.load("test_output.bmp", LoadMode::Map)) << bitCount << " bits";
+        }
+    }
+}
+
 // Filter Tests
 class FilterTest : public ::testing::Test {
 protected:
@@ -204,6 +478,681 @@ TEST_F(FilterTest, BoxBlurFilter) {
     EXPECT_EQ(testImage.getHeight(), originalImage.getHeight());
 }
 
+// Imagen sintética con un patrón fácil de reproducir
+static BmpImage makePatternImage(int width, int height) {
+    BmpImage img;
+    img.create(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            img.setPixel(x, y, { static_cast<uint8_t>((x * 37 + y * 11) % 256),
+                                 static_cast<uint8_t>((x * y + 7) % 256),
+                                 static_cast<uint8_t>((x ^ y) * 5 % 256) });
+        }
+    }
+    return img;
+}
+
+// Box blur por definición: promedio de los píxeles del kernel que caen dentro de la imagen
+static RGB referenceBoxBlur(const BmpImage& img, int x, int y, int size) {
+    int radius = size / 2;
+    int sums[3] = {0, 0, 0}, count = 0;
+    for (int j = max(0, y - radius); j <= min(img.getHeight() - 1, y + radius); ++j) {
+        for (int i = max(0, x - radius); i <= min(img.getWidth() - 1, x + radius); ++i) {
+            RGB pixel = img.getPixel(i, j);
+            sums[0] += pixel.blue;
+            sums[1] += pixel.green;
+            sums[2] += pixel.red;
+            ++count;
+        }
+    }
+    return { static_cast<uint8_t>((sums[0] + count / 2) / count),
+             static_cast<uint8_t>((sums[1] + count / 2) / count),
+             static_cast<uint8_t>((sums[2] + count / 2) / count) };
+}
+
+TEST(BoxBlurTest, MatchesDefinition) {
+    BmpImage original = makePatternImage(37, 23);
+    for (int size : {1, 3, 4, 9, 31, 101}) {
+        BmpImage blurred = original;
+        boxBlurFilter(blurred, { to_string(size) }, 4);
+        for (int y = 0; y < original.getHeight(); ++y) {
+            for (int x = 0; x < original.getWidth(); ++x) {
+                RGB expected = referenceBoxBlur(original, x, y, size);
+                RGB actual = blurred.getPixel(x, y);
+                ASSERT_EQ(actual.blue, expected.blue) << "kernel " << size << " en (" << x << ", " << y << ")";
+                ASSERT_EQ(actual.green, expected.green) << "kernel " << size << " en (" << x << ", " << y << ")";
+                ASSERT_EQ(actual.red, expected.red) << "kernel " << size << " en (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(KernelFilterTest, TiledMatchesDirect) {
+    // Máximo del canal rojo en un vecindario de 3x3 (leyendo siempre la imagen original)
+    auto maxRed = [](const BmpImage& img, int x, int y, const vector<string>&) -> RGB {
+        uint8_t red = 0;
+        for (int j = max(0, y - 1); j <= min(img.getHeight() - 1, y + 1); ++j) {
+            for (int i = max(0, x - 1); i <= min(img.getWidth() - 1, x + 1); ++i) {
+                red = max(red, img.getPixel(i, j).red);
+            }
+        }
+        return { 0, 0, red };
+    };
+
+    BmpImage original = makePatternImage(300, 70); // más de un bloque en cada dirección
+    BmpImage img = original;
+    for (int grain : {0, 1, 9}) {
+        img = original;
+        applyKernelFilter(img, maxRed, {}, 4, grain);
+        for (int y = 0; y < img.getHeight(); ++y) {
+            for (int x = 0; x < img.getWidth(); ++x) {
+                ASSERT_EQ(img.getPixel(x, y).red, maxRed(original, x, y, {}).red) << "(" << x << ", " << y << ")";
+            }
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(KernelFilterTest, PingPongBuffers) {
+    auto identity = [](const BmpImage& img, int x, int y, const vector<string>&) { return img.getPixel(x, y); };
+    BmpImage img = makePatternImage(16, 16);
+
+    // Dos pasos seguidos alternan entre los mismos dos buffers, sin reservar memoria nueva
+    const uint8_t* first = img.getRowData(0);
+    applyKernelFilter(img, identity, {}, 1);
+    const uint8_t* second = img.getRowData(0);
+    EXPECT_NE(first, second);
+    applyKernelFilter(img, identity, {}, 1);
+    EXPECT_EQ(img.getRowData(0), first);
+    applyKernelFilter(img, identity, {}, 1);
+    EXPECT_EQ(img.getRowData(0), second);
+    releaseFilterBuffers();
+}
+
+// Operaciones de prueba para applyPixelOp y applyKernelOp: interpretan los parámetros al construirse
+struct ScaleRedOp {
+    int factor;
+    explicit ScaleRedOp(const vector<string>& params) : factor(stoi(params.at(0))) {}
+    RGB operator()(const RGB& pixel) const {
+        return { pixel.blue, pixel.green, static_cast<uint8_t>(min(255, pixel.red * factor)) };
+    }
+};
+
+struct ShiftLeftOp {
+    int shift;
+    explicit ShiftLeftOp(const vector<string>& params) : shift(stoi(params.at(0))) {}
+    RGB operator()(const BmpImage& source, int x, int y) const {
+        return source.getRow(y)[min(source.getWidth() - 1, x + shift)];
+    }
+};
+
+TEST(KernelFilterTest, TemplateOpsMatchFunctionVersions) {
+    BmpImage original = makePatternImage(300, 70);
+    vector<string> params = {"2"};
+
+    BmpImage expected = original;
+    applyPixelFilter(expected, [](const RGB& pixel, const vector<string>& p) { return ScaleRedOp(p)(pixel); }, params, 4);
+    BmpImage img = original;
+    applyPixelOp(img, ScaleRedOp(params), 4);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        ASSERT_EQ(memcmp(img.getRowData(y), expected.getRowData(y), img.getWidth() * 3), 0) << "fila " << y;
+    }
+
+    expected = original;
+    applyKernelFilter(expected, [](const BmpImage& src, int x, int y, const vector<string>& p) { return ShiftLeftOp(p)(src, x, y); }, params, 4);
+    img = original;
+    applyKernelOp(img, ShiftLeftOp(params), 4);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        for (int x = 0; x < img.getWidth(); ++x) {
+            RGB actual = img.getPixel(x, y), wanted = expected.getPixel(x, y);
+            ASSERT_TRUE(actual.blue == wanted.blue && actual.green == wanted.green && actual.red == wanted.red)
+                << "(" << x << ", " << y << ")";
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(BoxBlurTest, RejectsInvalidKernel) {
+    BmpImage img = makePatternImage(4, 4);
+    EXPECT_THROW(boxBlurFilter(img, { "0" }, 1), invalid_argument);
+    EXPECT_THROW(boxBlurFilter(img, {}, 1), invalid_argument);
+}
+
+// Todas las versiones vectoriales tienen que dar exactamente lo mismo que la escalar
+TEST(SimdTest, MatchesScalar) {
+    registerFilters();
+    // Anchos que no son múltiplo del bloque vectorial, para ejercitar las colas
+    for (int width : {1, 15, 16, 33, 67}) {
+        BmpImage original = makePatternImage(width, 3);
+        for (const string& filter : {"negative", "grayscale", "threshold"}) {
+            for (int levels : {1, 2, 3, 8, 100, 256}) {
+                vector<string> params = { to_string(levels) };
+                limitSimdLevel(SimdLevel::Scalar);
+                BmpImage expected = original;
+                applyFilter(expected, filter, params, 1);
+                for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2}) {
+                    limitSimdLevel(level);
+                    BmpImage actual = original;
+                    applyFilter(actual, filter, params, 1);
+                    for (int y = 0; y < original.getHeight(); ++y) {
+                        ASSERT_EQ(memcmp(actual.getRowData(y), expected.getRowData(y), width * 3), 0)
+                            << filter << ":" << levels << ", ancho " << width << ", nivel " << static_cast<int>(level);
+                    }
+                }
+            }
+        }
+    }
+    limitSimdLevel(SimdLevel::AVX2);
+}
+
+TEST(SimdTest, ThresholdMatchesThresholdPixel) {
+    BmpImage img = makePatternImage(40, 4);
+    BmpImage original = img;
+    thresholdFilter(img, { "5" }, 1);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        for (int x = 0; x < img.getWidth(); ++x) {
+            RGB expected = thresholdPixel(original.getPixel(x, y), { "5" });
+            RGB actual = img.getPixel(x, y);
+            EXPECT_EQ(actual.red, expected.red);
+            EXPECT_EQ(actual.green, expected.green);
+            EXPECT_EQ(actual.blue, expected.blue);
+        }
+    }
+}
+
+TEST(PointProgramTest, FusedRunsMatchSeparateSteps) {
+    registerFilters();
+    vector<vector<FilterStep>> pipelines = {
+        {{"negative", {}}, {"threshold", {"8"}}, {"negative", {}}},
+        {{"negative", {}}, {"grayscale", {}}, {"threshold", {"3"}}},
+        {{"grayscale", {}}, {"negative", {}}, {"grayscale", {}}},
+        {{"threshold", {"256"}}, {"identity", {}}, {"negative", {}}, {"boxblur", {"3"}}, {"grayscale", {}}, {"negative", {}}},
+    };
+    BmpImage original = makePatternImage(37, 11);
+    // Con SIMD las corridas usan los kernels vectoriales; sin SIMD, tablas
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2}) {
+        limitSimdLevel(level);
+        for (const auto& steps : pipelines) {
+            BmpImage expected = original;
+            for (const auto& step : steps) {
+                applyFilter(expected, step.name, step.parameters, 2);
+            }
+            BmpImage img = original;
+            applyPipeline(img, steps, 2);
+            for (int y = 0; y < img.getHeight(); ++y) {
+                ASSERT_EQ(memcmp(img.getRowData(y), expected.getRowData(y), img.getWidth() * 3), 0)
+                    << steps.front().name << " ... " << steps.back().name << ", fila " << y;
+            }
+        }
+    }
+    limitSimdLevel(SimdLevel::AVX2);
+    releaseFilterBuffers();
+}
+
+TEST(PipelineTest, FusedMatchesStepByStep) {
+    registerFilters();
+    vector<vector<FilterStep>> pipelines = {
+        {{"boxblur", {"5"}}, {"negative", {}}, {"unsharp", {"3", "150"}}, {"grayscale", {}}, {"adaptive", {"7", "4"}}},
+        {{"negative", {}}, {"threshold", {"4"}}, {"boxblur", {"3"}}},
+        {{"unsharp", {"9", "80"}}, {"boxblur", {"9"}}},
+    };
+    BmpImage original = makePatternImage(600, 150); // varios bloques en cada dirección
+    for (const auto& steps : pipelines) {
+        BmpImage expected = original;
+        applyPipeline(expected, steps, 1);
+        BmpImage img = original;
+        applyPipelineFused(img, steps, 3);
+        for (int y = 0; y < img.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(img.getRowData(y), expected.getRowData(y), img.getWidth() * 3), 0)
+                << steps.front().name << " ... " << steps.back().name << ", fila " << y;
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(PlanarTest, RoundTrip) {
+    BmpImage original = makePatternImage(67, 5);
+    PlanarImage planar;
+    planar.fromImage(original, 2);
+    EXPECT_EQ(planar.getStride() % 64, 0);
+    EXPECT_EQ(planar.row(2, 3)[10], original.getPixel(10, 3).red);
+    BmpImage img;
+    planar.toImage(img, 2);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        ASSERT_EQ(memcmp(img.getRowData(y), original.getRowData(y), img.getWidth() * 3), 0) << "fila " << y;
+    }
+}
+
+TEST(PlanarTest, PipelineMatchesInterleaved) {
+    registerFilters();
+    vector<vector<FilterStep>> pipelines = {
+        {{"boxblur", {"5"}}, {"negative", {}}, {"unsharp", {"3", "150"}}, {"grayscale", {}}, {"adaptive", {"7", "4"}}},
+        {{"threshold", {"3"}}, {"boxblur", {"1"}}, {"unsharp", {"9", "-40"}}},
+        {{"boxblur", {"99"}}, {"identity", {}}}, // kernel más grande que la imagen
+        {{"gaussian", {"2.5"}}, {"unsharp", {"1.5", "120", "gaussian"}}, {"gaussian", {"40"}}},
+    };
+    for (auto [width, height] : {pair{61, 37}, pair{300, 9}}) {
+        BmpImage original = makePatternImage(width, height);
+        for (const auto& steps : pipelines) {
+            BmpImage expected = original;
+            applyPipeline(expected, steps, 1);
+            BmpImage img = original;
+            applyPipelinePlanar(img, steps, 3);
+            for (int y = 0; y < img.getHeight(); ++y) {
+                ASSERT_EQ(memcmp(img.getRowData(y), expected.getRowData(y), img.getWidth() * 3), 0)
+                    << steps.front().name << " ... " << steps.back().name << ", " << width << "x" << height << ", fila " << y;
+            }
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(PointProgramTest, RejectsInvalidParameters) {
+    registerFilters();
+    PointProgram program;
+    EXPECT_THROW(compilePointStep(program, "threshold", {"0"}), invalid_argument);
+    EXPECT_FALSE(compilePointStep(program, "boxblur", {"3"}));
+    EXPECT_THROW(compilePointStep(program, "nope", {}), runtime_error);
+}
+
+TEST(PointProgramTest, TablesComposeWithKernels) {
+    // Tablas seguidas se juntan en una sola; un kernel en el medio las separa
+    PointProgram program;
+    program.map([](int channel, uint8_t value) { return static_cast<uint8_t>(channel == 2 ? value / 2 : value); });
+    program.luminance();
+    program.rowKernel(negateRow);
+    program.map([](int, uint8_t value) { return static_cast<uint8_t>(value | 1); });
+
+    const uint8_t original[6] = { 10, 20, 200, 255, 0, 100 };
+    uint8_t row[6];
+    memcpy(row, original, sizeof(row));
+    program.applyRow(row, 2);
+    for (int i = 0; i < 2; ++i) {
+        const uint8_t* source = original + i * 3;
+        int gray = (29 * source[0] + 150 * source[1] + 77 * (source[2] / 2) + 128) >> 8;
+        uint8_t expected = static_cast<uint8_t>((255 - gray) | 1);
+        EXPECT_EQ(row[i * 3], expected);
+        EXPECT_EQ(row[i * 3 + 1], expected);
+        EXPECT_EQ(row[i * 3 + 2], expected);
+    }
+}
+
+TEST(IntegralImageTest, RectangleSums) {
+    BmpImage img = makePatternImage(19, 13);
+    IntegralImage integral;
+    integral.build(img, 4);
+    for (auto [x0, y0, x1, y1] : vector<array<int, 4>>{{0, 0, 19, 13}, {3, 2, 4, 3}, {5, 0, 17, 9}, {0, 7, 19, 13}}) {
+        uint32_t expected[3] = {0, 0, 0};
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                RGB pixel = img.getPixel(x, y);
+                expected[0] += pixel.blue;
+                expected[1] += pixel.green;
+                expected[2] += pixel.red;
+            }
+        }
+        uint64_t sums[3];
+        integral.sum(x0, y0, x1, y1, sums);
+        EXPECT_EQ(sums[0], expected[0]);
+        EXPECT_EQ(sums[1], expected[1]);
+        EXPECT_EQ(sums[2], expected[2]);
+    }
+}
+
+// Imagen grande de un solo color, para ventanas cuyas sumas no caben en 32 bits
+static BmpImage makeHugeFlatImage(int width, int height, uint8_t value) {
+    BmpImage img;
+    img.create(width, height);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        memset(img.getRowData(y), value, img.getWidth() * 3);
+    }
+    return img;
+}
+
+TEST(IntegralImageTest, WindowsOf2To24PixelsAreExact) {
+    // Con 2^24 píxeles o más, una ventana que cubre la imagen entera ya no cabe en 32 bits
+    BmpImage img = makeHugeFlatImage(4097, 4096, 255);
+    boxBlurFilter(img, {"9999"}, 4);
+    for (int y : {0, 2048, 4095}) {
+        for (int x : {0, 2048, 4096}) {
+            RGB pixel = img.getPixel(x, y);
+            ASSERT_EQ(pixel.blue, 255) << "(" << x << ", " << y << ")";
+            ASSERT_EQ(pixel.red, 255) << "(" << x << ", " << y << ")";
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(GaussianTest, BoxRadiiApproximateVariance) {
+    for (double sigma : {0.8, 1.0, 2.5, 5.0, 13.7, 50.0}) {
+        array<int, 3> radii = gaussianBoxRadii(sigma);
+        // Un box de ancho w = 2r + 1 tiene varianza (w² - 1) / 12
+        double variance = 0;
+        for (int radius : radii) variance += ((2 * radius + 1) * (2 * radius + 1) - 1) / 12.0;
+        EXPECT_NEAR(variance, sigma * sigma, max(0.5, 0.1 * sigma * sigma)) << "sigma " << sigma;
+    }
+    EXPECT_EQ(gaussianReach({"0.1"}), 0);
+    EXPECT_THROW(gaussianSigma({"0"}), invalid_argument);
+    EXPECT_THROW(gaussianSigma({}), invalid_argument);
+}
+
+TEST(GaussianTest, MatchesConvolution) {
+    // Lejos de los bordes, las tres pasadas de box blur tienen que parecerse a la convolución con la
+    // gaussiana muestreada
+    const double sigma = 3;
+    const int support = 12;
+    BmpImage original = makePatternImage(80, 70);
+    BmpImage blurred = original;
+    gaussianFilter(blurred, { "3" }, 4);
+
+    vector<double> weights(2 * support + 1);
+    double total = 0;
+    for (int i = -support; i <= support; ++i) total += weights[i + support] = exp(-i * i / (2 * sigma * sigma));
+    double errorSum = 0;
+    int samples = 0;
+    for (int y = support; y < original.getHeight() - support; ++y) {
+        for (int x = support; x < original.getWidth() - support; ++x) {
+            double expected = 0;
+            for (int j = -support; j <= support; ++j) {
+                for (int i = -support; i <= support; ++i) {
+                    expected += weights[i + support] * weights[j + support] * original.getPixel(x + i, y + j).green;
+                }
+            }
+            expected /= total * total;
+            double error = abs(blurred.getPixel(x, y).green - expected);
+            ASSERT_LT(error, 6) << "en (" << x << ", " << y << ")";
+            errorSum += error;
+            ++samples;
+        }
+    }
+    EXPECT_LT(errorSum / samples, 1.5);
+
+    // Una imagen constante no cambia, ni siquiera en los bordes
+    BmpImage flat;
+    flat.create(31, 9);
+    for (int y = 0; y < 9; ++y) {
+        for (int x = 0; x < 31; ++x) flat.setPixel(x, y, { 200, 17, 90 });
+    }
+    gaussianFilter(flat, { "7.5" }, 2);
+    for (int y = 0; y < 9; ++y) {
+        for (int x = 0; x < 31; ++x) {
+            RGB pixel = flat.getPixel(x, y);
+            ASSERT_EQ(pixel.blue, 200);
+            ASSERT_EQ(pixel.green, 17);
+            ASSERT_EQ(pixel.red, 90);
+        }
+    }
+}
+
+TEST(UnsharpMaskTest, MatchesDefinition) {
+    BmpImage original = makePatternImage(23, 17);
+    BmpImage sharpened = original;
+    unsharpMaskFilter(sharpened, { "5", "150" }, 4);
+    for (int y = 0; y < original.getHeight(); ++y) {
+        for (int x = 0; x < original.getWidth(); ++x) {
+            RGB orig = original.getPixel(x, y);
+            RGB blur = referenceBoxBlur(original, x, y, 5);
+            RGB actual = sharpened.getPixel(x, y);
+            EXPECT_NEAR(actual.blue, clamp(orig.blue + 1.5 * (orig.blue - blur.blue), 0.0, 255.0), 1);
+            EXPECT_NEAR(actual.green, clamp(orig.green + 1.5 * (orig.green - blur.green), 0.0, 255.0), 1);
+            EXPECT_NEAR(actual.red, clamp(orig.red + 1.5 * (orig.red - blur.red), 0.0, 255.0), 1);
+        }
+    }
+}
+
+TEST(UnsharpMaskTest, FlatImageWithHugeWindowIsUnchanged) {
+    // La ventana cubre la imagen entera: la suma de cada canal pasa de 2^32
+    BmpImage img = makeHugeFlatImage(6000, 5000, 150);
+    unsharpMaskFilter(img, {"99999", "10"}, 4);
+    for (int y : {0, 2500, 4999}) {
+        for (int x : {0, 3000, 5999}) {
+            RGB pixel = img.getPixel(x, y);
+            ASSERT_EQ(pixel.green, 150) << "(" << x << ", " << y << ")";
+        }
+    }
+}
+
+TEST(PlanarTest, HugeWindowsAreExact) {
+    registerFilters();
+    // Las sumas de una ventana que cubre la imagen entera pasan de 2^32, como en las versiones BGR
+    BmpImage img = makeHugeFlatImage(6000, 5000, 255);
+    applyPipelinePlanar(img, {{"boxblur", {"9999"}}}, 4);
+    BmpImage gray = makeHugeFlatImage(6000, 5000, 150);
+    applyPipelinePlanar(gray, {{"unsharp", {"99999", "10"}}}, 4);
+    for (int y : {0, 2500, 4999}) {
+        for (int x : {0, 3000, 5999}) {
+            ASSERT_EQ(img.getPixel(x, y).blue, 255) << "(" << x << ", " << y << ")";
+            ASSERT_EQ(gray.getPixel(x, y).red, 150) << "(" << x << ", " << y << ")";
+        }
+    }
+    releaseFilterBuffers();
+}
+
+TEST(UnsharpMaskTest, BandsMatchBoxBlur) {
+    // Con varias bandas, cada una tiene que leer las filas originales de sus vecinas
+    BmpImage original = makePatternImage(45, 500);
+    for (int size : {3, 9, 21, 1001}) {
+        BmpImage blurred = original;
+        boxBlurFilter(blurred, { to_string(size) }, 1);
+        BmpImage sharpened = original;
+        unsharpMaskFilter(sharpened, { to_string(size), "170" }, 4);
+        for (int y = 0; y < original.getHeight(); ++y) {
+            for (int x = 0; x < original.getWidth(); ++x) {
+                const uint8_t* orig = &original.getRowData(y)[x * 3];
+                const uint8_t* blur = &blurred.getRowData(y)[x * 3];
+                const uint8_t* actual = &sharpened.getRowData(y)[x * 3];
+                for (int c = 0; c < 3; ++c) {
+                    int delta = (orig[c] - blur[c]) * 170;
+                    int rounded = delta >= 0 ? (delta + 50) / 100 : (delta - 50) / 100;
+                    ASSERT_EQ(actual[c], clamp(orig[c] + rounded, 0, 255))
+                        << "kernel " << size << " en (" << x << ", " << y << "), canal " << c;
+                }
+            }
+        }
+    }
+}
+
+TEST(ResizeTest, HalvingAveragesBlocks) {
+    BmpImage original = makePatternImage(38, 26);
+    BmpImage half = original;
+    scaleFilter(half, { "0.5" }, 3);
+    ASSERT_EQ(half.getWidth(), 19);
+    ASSERT_EQ(half.getHeight(), 13);
+    for (int y = 0; y < half.getHeight(); ++y) {
+        for (int x = 0; x < half.getWidth(); ++x) {
+            for (int c = 0; c < 3; ++c) {
+                int sum = 0;
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) sum += original.getRowData(2 * y + dy)[(2 * x + dx) * 3 + c];
+                }
+                ASSERT_EQ(half.getRowData(y)[x * 3 + c], (sum + 2) / 4) << "(" << x << ", " << y << "), canal " << c;
+            }
+        }
+    }
+}
+
+TEST(ResizeTest, ArbitrarySizesKeepFlatColors) {
+    // Los pesos de cada pixel suman exactamente 1, reduciendo o ampliando
+    BmpImage flat;
+    flat.create(37, 23, 32);
+    for (int y = 0; y < flat.getHeight(); ++y) {
+        for (int x = 0; x < flat.getWidth(); ++x) flat.setPixel(x, y, { 255, 7, 128 });
+        fill(flat.getAlphaRow(y), flat.getAlphaRow(y) + flat.getWidth(), 200);
+    }
+    for (auto [width, height] : vector<pair<int, int>>{ {10, 6}, {36, 22}, {1, 1}, {80, 50}, {37, 5} }) {
+        BmpImage resized = flat;
+        resizeFilter(resized, { to_string(width), to_string(height) }, 2);
+        ASSERT_EQ(resized.getWidth(), width);
+        ASSERT_EQ(resized.getHeight(), height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                RGB pixel = resized.getPixel(x, y);
+                ASSERT_EQ(pixel.blue, 255);
+                ASSERT_EQ(pixel.green, 7);
+                ASSERT_EQ(pixel.red, 128);
+                ASSERT_EQ(resized.getAlphaRow(y)[x], 200);
+            }
+        }
+    }
+}
+
+TEST(ResizeTest, TargetSizes) {
+    EXPECT_EQ(resizeTarget({ "100" }, 400, 300), make_pair(100, 75));
+    EXPECT_EQ(resizeTarget({ "0", "30" }, 400, 300), make_pair(40, 30));
+    EXPECT_EQ(resizeTarget({ "50", "60" }, 400, 300), make_pair(50, 60));
+    EXPECT_EQ(scaleTarget({ "0.25" }, 401, 3), make_pair(100, 1));
+    EXPECT_THROW(resizeTarget({}, 400, 300), invalid_argument);
+    EXPECT_THROW(resizeTarget({ "0", "0" }, 400, 300), invalid_argument);
+    EXPECT_THROW(resizeTarget({ "-5" }, 400, 300), invalid_argument);
+    EXPECT_THROW(scaleTarget({ "0" }, 400, 300), invalid_argument);
+    EXPECT_THROW(scaleTarget({ "1e12" }, 400, 300), invalid_argument);
+}
+
+TEST(ResizeTest, HeadersFollowNewSize) {
+    BmpImage img = makePatternImage(101, 67);
+    resizeFilter(img, { "33" }, 2);
+    ASSERT_TRUE(img.save("resize_output.bmp"));
+    // 33 píxeles de 3 bytes más 1 de relleno por fila, y 22 filas (101 x 67 en proporción)
+    EXPECT_EQ(filesystem::file_size("resize_output.bmp"), 54u + 100 * 22);
+    BmpImage reloaded;
+    ASSERT_TRUE(reloaded.load("resize_output.bmp"));
+    EXPECT_EQ(reloaded.getWidth(), 33);
+    EXPECT_EQ(reloaded.getHeight(), 22);
+    for (int y = 0; y < img.getHeight(); ++y) {
+        ASSERT_EQ(memcmp(reloaded.getRowData(y), img.getRowData(y), img.getWidth() * 3), 0);
+    }
+    filesystem::remove("resize_output.bmp");
+}
+
+TEST(ResizeTest, PipelinesSplitAtResize) {
+    registerFilters();
+    BmpImage original = makePatternImage(150, 90);
+    vector<FilterStep> steps = {
+        {"boxblur", {"3"}}, {"negative", {}}, {"scale", {"0.4"}}, {"unsharp", {"5", "150"}}, {"boxblur", {"3"}}
+    };
+    BmpImage expected = original;
+    for (const auto& step : steps) applyFilter(expected, step.name, step.parameters, 1);
+    ASSERT_EQ(expected.getWidth(), 60);
+
+    BmpImage fused = original;
+    applyPipelineFused(fused, steps, 3);
+    BmpImage planar = original;
+    applyPipelinePlanar(planar, steps, 3);
+    for (BmpImage* actual : { &fused, &planar }) {
+        ASSERT_EQ(actual->getWidth(), expected.getWidth());
+        ASSERT_EQ(actual->getHeight(), expected.getHeight());
+        for (int y = 0; y < expected.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual->getRowData(y), expected.getRowData(y), expected.getWidth() * 3), 0) << "fila " << y;
+        }
+    }
+
+    ASSERT_TRUE(original.save("resize_input.bmp"));
+    EXPECT_THROW(applyPipelineInStrips("resize_input.bmp", "resize_output.bmp", steps, 2, 16), invalid_argument);
+    EXPECT_FALSE(filesystem::exists("resize_output.bmp"));
+    filesystem::remove("resize_input.bmp");
+}
+
+TEST(HistogramTest, MatchesSerialCount) {
+    BmpImage img = makePatternImage(103, 37);
+    array<array<uint64_t, 256>, 3> counts{};
+    array<uint64_t, 3> sums{};
+    for (int y = 0; y < img.getHeight(); ++y) {
+        const uint8_t* row = img.getRowData(y);
+        for (int i = 0; i < img.getWidth() * 3; ++i) {
+            ++counts[i % 3][row[i]];
+            sums[i % 3] += row[i];
+        }
+    }
+    auto row = [&](int channel, int y) { return img.getRowData(y) + channel; };
+    ImageHistogram histogram = imageHistogram(row, 3, img.getWidth(), img.getHeight(), 4);
+    EXPECT_EQ(histogram.pixels, 103u * 37u);
+    for (int c = 0; c < 3; ++c) {
+        const ChannelStats& stats = histogram.channels[c];
+        EXPECT_EQ(stats.counts, counts[c]) << "canal " << c;
+        EXPECT_EQ(stats.sum, sums[c]) << "canal " << c;
+        int first = find_if(counts[c].begin(), counts[c].end(), [](uint64_t n) { return n > 0; }) - counts[c].begin();
+        int last = 255 - (find_if(counts[c].rbegin(), counts[c].rend(), [](uint64_t n) { return n > 0; }) - counts[c].rbegin());
+        EXPECT_EQ(stats.minimum, first) << "canal " << c;
+        EXPECT_EQ(stats.maximum, last) << "canal " << c;
+    }
+
+    // Los parciales de dos mitades de la imagen suman lo mismo que la imagen entera
+    ImageHistogram top = imageHistogram(row, 3, img.getWidth(), 20, 1);
+    ImageHistogram bottom = imageHistogram([&](int channel, int y) { return row(channel, y + 20); }, 3,
+                                           img.getWidth(), img.getHeight() - 20, 1);
+    top.merge(bottom);
+    EXPECT_EQ(top.pixels, histogram.pixels);
+    for (int c = 0; c < 3; ++c) {
+        EXPECT_EQ(top.channels[c].counts, histogram.channels[c].counts);
+        EXPECT_EQ(top.channels[c].sum, histogram.channels[c].sum);
+        EXPECT_EQ(top.channels[c].minimum, histogram.channels[c].minimum);
+        EXPECT_EQ(top.channels[c].maximum, histogram.channels[c].maximum);
+    }
+}
+
+TEST(HistogramTest, StretchesAndEqualizesChannels) {
+    registerFilters();
+    // Azul de 50 a 100 en gradiente, verde con dos valores (3/4 en 10 y 1/4 en 20), rojo constante
+    BmpImage img;
+    img.create(51, 4);
+    for (int y = 0; y < 4; ++y) {
+        span<RGB> row = img.getRow(y);
+        for (int x = 0; x < 51; ++x) row[x] = { static_cast<uint8_t>(50 + x), static_cast<uint8_t>(y < 3 ? 10 : 20), 77 };
+    }
+
+    BmpImage stretched = img;
+    applyFilter(stretched, "autolevels", {}, 2);
+    for (int x = 0; x < 51; ++x) {
+        EXPECT_EQ(stretched.getRow(0)[x].blue, (x * 510 + 50) / 100) << "x = " << x;
+    }
+    EXPECT_EQ(stretched.getRow(0)[0].green, 0);
+    EXPECT_EQ(stretched.getRow(3)[0].green, 255);
+    EXPECT_EQ(stretched.getRow(2)[5].red, 77);
+
+    // Con un recorte del 2% (4 píxeles de 204 por extremo) se ignoran los dos valores más bajos y altos de azul
+    BmpImage clipped = img;
+    applyFilter(clipped, "autolevels", {"2"}, 2);
+    EXPECT_EQ(clipped.getRow(0)[1].blue, 0);
+    EXPECT_EQ(clipped.getRow(0)[49].blue, 255);
+    EXPECT_EQ(clipped.getRow(0)[25].blue, 128);
+    EXPECT_THROW(applyFilter(clipped, "autolevels", {"50"}, 1), invalid_argument);
+
+    BmpImage equalized = img;
+    applyFilter(equalized, "equalize", {}, 2);
+    EXPECT_EQ(equalized.getRow(0)[0].blue, 0);
+    EXPECT_EQ(equalized.getRow(0)[50].blue, 255);
+    EXPECT_EQ(equalized.getRow(0)[0].green, 0);
+    EXPECT_EQ(equalized.getRow(3)[0].green, 255);
+    EXPECT_EQ(equalized.getRow(1)[7].red, 77);
+    // Un gradiente parejo ya está ecualizado: queda como el estiramiento
+    for (int x = 0; x < 51; ++x) {
+        EXPECT_EQ(equalized.getRow(0)[x].blue, stretched.getRow(0)[x].blue) << "x = " << x;
+    }
+}
+
+TEST(HistogramTest, PipelinesMatchAndStripsReject) {
+    registerFilters();
+    BmpImage original = makePatternImage(120, 70);
+    vector<FilterStep> steps = { {"boxblur", {"3"}}, {"equalize", {}}, {"negative", {}}, {"autolevels", {"1"}} };
+    BmpImage expected = original;
+    for (const auto& step : steps) applyFilter(expected, step.name, step.parameters, 1);
+
+    BmpImage fused = original;
+    applyPipelineFused(fused, steps, 3);
+    BmpImage planar = original;
+    applyPipelinePlanar(planar, steps, 3);
+    for (BmpImage* actual : { &fused, &planar }) {
+        for (int y = 0; y < expected.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual->getRowData(y), expected.getRowData(y), expected.getWidth() * 3), 0) << "fila " << y;
+        }
+    }
+
+    ASSERT_TRUE(original.save("histogram_input.bmp"));
+    EXPECT_THROW(applyPipelineInStrips("histogram_input.bmp", "histogram_output.bmp", steps, 2, 16), invalid_argument);
+    EXPECT_FALSE(filesystem::exists("histogram_output.bmp"));
+    filesystem::remove("histogram_input.bmp");
+}
+
 TEST_F(FilterTest, UnsharpMaskFilter) {
     vector<string> params = {"5", "150"}; // 5x5 kernel, 150% strength
     BmpImage originalImage = testImage;
@@ -263,6 +1212,19 @@ TEST_F(UtilsTest, ParsePipelineBasic) {
     EXPECT_EQ(steps[1].name, "negative");
 }
 
+TEST_F(UtilsTest, ParseOptions) {
+    const char* testArgv[] = {"program", "input.bmp", "output.bmp", "4", "grayscale", "--strip=64", "negative", "--verbose"};
+    int testArgc = 8;
+
+    vector<FilterStep> steps = parsePipeline(testArgc, const_cast<char**>(testArgv));
+    map<string, string> options = parseOptions(testArgc, const_cast<char**>(testArgv));
+
+    EXPECT_EQ(steps.size(), 2);
+    EXPECT_EQ(options.size(), 2);
+    EXPECT_EQ(options["strip"], "64");
+    EXPECT_EQ(options["verbose"], "");
+}
+
 // Integration tests
 class IntegrationTest : public ::testing::Test {
 protected:
@@ -293,6 +1255,248 @@ TEST_F(IntegrationTest, FilterPipeline) {
     }
 }
 
+TEST_F(IntegrationTest, StripPipelineMatchesWholeImage) {
+    BmpImage original = makePatternImage(29, 41);
+    ASSERT_TRUE(original.save("strip_input.bmp"));
+
+    vector<FilterStep> steps = {
+        {"boxblur", {"5"}}, {"negative", {}}, {"unsharp", {"3", "150"}}, {"threshold", {"8"}}
+    };
+    EXPECT_EQ(pipelineHalo(steps), 3);
+
+    BmpImage expected = original;
+    applyPipeline(expected, steps, 2);
+
+    for (int stripRows : {1, 4, 7, 100}) {
+        ASSERT_TRUE(applyPipelineInStrips("strip_input.bmp", "strip_output.bmp", steps, 2, stripRows));
+        BmpImage actual;
+        ASSERT_TRUE(actual.load("strip_output.bmp"));
+        ASSERT_EQ(actual.getHeight(), expected.getHeight());
+        for (int y = 0; y < expected.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual.getRowData(y), expected.getRowData(y), expected.getWidth() * 3), 0)
+                << "franjas de " << stripRows << ", fila " << y;
+        }
+    }
+
+    filesystem::remove("strip_input.bmp");
+    filesystem::remove("strip_output.bmp");
+}
+
+TEST_F(IntegrationTest, StripPipelineKeepsFileFormat) {
+    BmpImage original = makePatternImage(23, 31);
+    BmpImage bgra;
+    bgra.create(23, 31, 32, true);
+    for (int y = 0; y < 31; ++y) {
+        memcpy(bgra.getRowData(y), original.getRowData(y), 23 * 3);
+        for (int x = 0; x < 23; ++x) bgra.getAlphaRow(y)[x] = static_cast<uint8_t>(x * 11 + y);
+    }
+    ASSERT_TRUE(bgra.save("strip_input.bmp"));
+
+    vector<FilterStep> steps = { {"boxblur", {"3"}}, {"unsharp", {"3", "150"}} };
+    BmpImage expected = bgra;
+    applyPipeline(expected, steps, 2);
+    ASSERT_TRUE(applyPipelineInStrips("strip_input.bmp", "strip_output.bmp", steps, 2, 5));
+    BmpImage actual;
+    ASSERT_TRUE(actual.load("strip_output.bmp"));
+    EXPECT_EQ(actual.getBitCount(), 32);
+    EXPECT_TRUE(actual.isTopDown());
+    for (int y = 0; y < expected.getHeight(); ++y) {
+        ASSERT_EQ(memcmp(actual.getRowData(y), expected.getRowData(y), 23 * 3), 0) << "fila " << y;
+        ASSERT_EQ(memcmp(actual.getAlphaRow(y), bgra.getAlphaRow(y), 23), 0) << "fila " << y;
+    }
+
+    filesystem::remove("strip_input.bmp");
+    filesystem::remove("strip_output.bmp");
+}
+
+TEST_F(IntegrationTest, BatchMatchesSingleImages) {
+    filesystem::create_directories("batch_input");
+    vector<FilterStep> steps = { {"boxblur", {"3"}}, {"negative", {}}, {"threshold", {"4"}} };
+    vector<BmpImage> expected;
+    for (int i = 0; i < 5; ++i) {
+        BmpImage img = makePatternImage(20 + 7 * i, 9 + i);
+        ASSERT_TRUE(img.save("batch_input/img" + to_string(i) + ".bmp"));
+        applyPipeline(img, steps, 1);
+        expected.push_back(move(img));
+    }
+
+    vector<string> inputs = listBatchInputs("batch_input");
+    ASSERT_EQ(inputs.size(), 5u);
+    inputs.push_back("batch_input/missing.bmp");
+    BatchStats stats = applyPipelineBatch(inputs, "batch_output", steps, 3);
+    EXPECT_EQ(stats.processed, 5);
+    EXPECT_EQ(stats.failed, 1);
+
+    for (int i = 0; i < 5; ++i) {
+        BmpImage actual;
+        ASSERT_TRUE(actual.load("batch_output/img" + to_string(i) + ".bmp"));
+        ASSERT_EQ(actual.getWidth(), expected[i].getWidth());
+        for (int y = 0; y < actual.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual.getRowData(y), expected[i].getRowData(y), actual.getWidth() * 3), 0)
+                << "imagen " << i << ", fila " << y;
+        }
+    }
+
+    EXPECT_THROW(applyPipelineBatch(inputs, "batch_output", {{"nope", {}}}, 2), runtime_error);
+    filesystem::remove_all("batch_input");
+    filesystem::remove_all("batch_output");
+}
+
+TEST_F(IntegrationTest, BatchFailsRepeatedOutputNames) {
+    filesystem::create_directories("batch_a");
+    filesystem::create_directories("batch_b");
+    BmpImage first = makePatternImage(12, 8);
+    BmpImage second = makePatternImage(30, 5);
+    ASSERT_TRUE(first.save("batch_a/img.bmp"));
+    ASSERT_TRUE(second.save("batch_b/img.bmp"));
+
+    BatchStats stats = applyPipelineBatch({"batch_a/img.bmp", "batch_b/img.bmp"}, "batch_output",
+                                          {{"negative", {}}}, 2);
+    EXPECT_EQ(stats.processed, 1);
+    EXPECT_EQ(stats.failed, 1);
+
+    // La salida es la de la primera entrada, no una mezcla ni la última en escribirse
+    BmpImage actual;
+    ASSERT_TRUE(actual.load("batch_output/img.bmp"));
+    EXPECT_EQ(actual.getWidth(), 12);
+    EXPECT_EQ(actual.getHeight(), 8);
+    filesystem::remove_all("batch_a");
+    filesystem::remove_all("batch_b");
+    filesystem::remove_all("batch_output");
+}
+
+TEST(ServerTest, ParsesJobLines) {
+    registerFilters();
+    ServerJob job = parseJob("entrada.bmp  salida.bmp boxblur:3 negative");
+    EXPECT_EQ(job.inputFile, "entrada.bmp");
+    EXPECT_EQ(job.outputFile, "salida.bmp");
+    ASSERT_EQ(job.steps.size(), 2u);
+    EXPECT_EQ(job.steps[0].name, "boxblur");
+    EXPECT_EQ(job.steps[0].parameters, vector<string>{"3"});
+    EXPECT_EQ(job.steps[1].name, "negative");
+
+    EXPECT_THROW(parseJob("entrada.bmp"), invalid_argument);
+    EXPECT_THROW(parseJob("entrada.bmp salida.bmp"), invalid_argument);
+    EXPECT_THROW(parseJob("entrada.bmp salida.bmp nope"), runtime_error);
+}
+
+TEST_F(IntegrationTest, ServerMatchesSingleImages) {
+    vector<FilterStep> steps = { {"boxblur", {"2"}}, {"negative", {}} };
+    vector<BmpImage> expected;
+    string requests = "# comentario\n\n";
+    for (int i = 0; i < 4; ++i) {
+        BmpImage img = makePatternImage(17 + 5 * i, 11 + i);
+        ASSERT_TRUE(img.save("server_in" + to_string(i) + ".bmp"));
+        applyPipeline(img, steps, 1);
+        expected.push_back(move(img));
+        requests += "server_in" + to_string(i) + ".bmp server_out" + to_string(i) + ".bmp boxblur:2 negative\n";
+    }
+    requests += "falta.bmp server_out9.bmp negative\nserver_in0.bmp x.bmp nope\nshutdown\n";
+    requests += "server_in0.bmp server_out8.bmp negative\n";
+
+    istringstream in(requests);
+    ostringstream out;
+    serveStream(in, out, 2, 2);
+
+    // Las respuestas llegan en el orden en que terminan los trabajos
+    vector<string> responses;
+    istringstream lines(out.str());
+    for (string line; getline(lines, line);) responses.push_back(line);
+    ASSERT_EQ(responses.size(), 6u);
+    int ok = 0;
+    for (const string& response : responses) {
+        if (response.rfind("ok server_out", 0) == 0) ++ok;
+    }
+    EXPECT_EQ(ok, 4);
+    EXPECT_EQ(count(responses.begin(), responses.end(), "error - Filtro 'nope' no registrado."), 1);
+    EXPECT_EQ(count_if(responses.begin(), responses.end(),
+                       [](const string& r) { return r.rfind("error server_out9.bmp ", 0) == 0; }), 1);
+    // Lo que llega después de shutdown no se procesa
+    EXPECT_FALSE(filesystem::exists("server_out8.bmp"));
+
+    for (int i = 0; i < 4; ++i) {
+        BmpImage actual;
+        ASSERT_TRUE(actual.load("server_out" + to_string(i) + ".bmp"));
+        ASSERT_EQ(actual.getWidth(), expected[i].getWidth());
+        for (int y = 0; y < actual.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual.getRowData(y), expected[i].getRowData(y), actual.getWidth() * 3), 0)
+                << "imagen " << i << ", fila " << y;
+        }
+        filesystem::remove("server_in" + to_string(i) + ".bmp");
+        filesystem::remove("server_out" + to_string(i) + ".bmp");
+    }
+}
+
+/**
+ * @brief Se conecta al socket del servidor (reintentando mientras arranca), manda líneas y lee
+ * `responses` respuestas.
+ */
+static vector<string> askServer(const string& path, const string& lines, int responses) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = -1;
+    for (int attempt = 0; attempt < 500 && fd < 0; ++attempt) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    }
+    vector<string> received;
+    if (fd < 0) return received;
+    send(fd, lines.data(), lines.size(), MSG_NOSIGNAL);
+    string pending;
+    char buffer[256];
+    while (static_cast<int>(received.size()) < responses) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        pending.append(buffer, n);
+        size_t newline;
+        while ((newline = pending.find('\n')) != string::npos) {
+            received.push_back(pending.substr(0, newline));
+            pending.erase(0, newline + 1);
+        }
+    }
+    close(fd);
+    return received;
+}
+
+TEST_F(IntegrationTest, SocketServerHandlesSequentialConnections) {
+    BmpImage img = makePatternImage(31, 17);
+    ASSERT_TRUE(img.save("socket_in.bmp"));
+    BmpImage expected = img;
+    applyFilter(expected, "negative", {}, 1);
+
+    string path = (filesystem::temp_directory_path() / ("tp_server_" + to_string(getpid()) + ".sock")).string();
+    bool served = false;
+    thread server([&] { served = serveSocket(path, 1, 2); });
+
+    // Una conexión por trabajo, como las herramientas que usan el servidor
+    for (int i = 0; i < 20; ++i) {
+        string output = "socket_out" + to_string(i % 2) + ".bmp";
+        vector<string> responses = askServer(path, "socket_in.bmp " + output + " negative\n", 1);
+        ASSERT_EQ(responses.size(), 1u) << "conexión " << i;
+        EXPECT_EQ(responses[0].rfind("ok " + output + " ", 0), 0u) << responses[0];
+    }
+    vector<string> responses = askServer(path, "socket_in.bmp x.bmp nope\n", 1);
+    ASSERT_EQ(responses.size(), 1u);
+    EXPECT_EQ(responses[0], "error - Filtro 'nope' no registrado.");
+
+    askServer(path, "shutdown\n", 0);
+    server.join();
+    EXPECT_TRUE(served);
+    EXPECT_FALSE(filesystem::exists(path));
+
+    BmpImage actual;
+    ASSERT_TRUE(actual.load("socket_out1.bmp"));
+    for (int y = 0; y < expected.getHeight(); ++y) {
+        ASSERT_EQ(memcmp(actual.getRowData(y), expected.getRowData(y), expected.getWidth() * 3), 0) << "fila " << y;
+    }
+    for (const char* name : { "socket_in.bmp", "socket_out0.bmp", "socket_out1.bmp" }) filesystem::remove(name);
+}
+
 // Performance tests (basic)
 TEST_F(IntegrationTest, BasicPerformanceTest) {
     BmpImage img;
@@ -357,3 +1561,328 @@ TEST_F(EdgeCaseTest, LargeThreadCount) {
     }
 }
 
+// Trace tests
+TEST(TraceTest, RecordsStagesAndWork) {
+    registerFilters();
+    clearTrace();
+    enableTracing(true);
+    BmpImage img = makePatternImage(64, 64);
+    {
+        TraceScope trace("etapa", "lectura");
+    }
+    applyPipeline(img, {{"boxblur", {"3"}}, {"negative", {}}, {"grayscale", {}}}, 2);
+    enableTracing(false);
+
+    stringstream summary;
+    printTraceSummary(summary);
+    EXPECT_NE(summary.str().find("lectura"), string::npos);
+    EXPECT_NE(summary.str().find("boxblur"), string::npos);
+    EXPECT_NE(summary.str().find("negative+grayscale"), string::npos);
+    EXPECT_NE(summary.str().find("principal"), string::npos);
+
+    ASSERT_TRUE(writeTrace("trace_test.json"));
+    ifstream file("trace_test.json");
+    string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    EXPECT_EQ(json.rfind("{\"traceEvents\": [", 0), 0u);
+    EXPECT_NE(json.find("\"name\": \"tarea\", \"cat\": \"trabajo\", \"ph\": \"X\""), string::npos);
+    filesystem::remove("trace_test.json");
+
+    // Desactivado no se registra nada
+    clearTrace();
+    applyFilter(img, "negative", {}, 1);
+    stringstream empty;
+    printTraceSummary(empty);
+    EXPECT_TRUE(empty.str().empty());
+}
+
+TEST(TraceTest, NamesWorkersCreatedBeforeTracing) {
+    // Con la traza apagada el pool no registra los nombres, pero los recuerda para cuando se encienda
+    enableTracing(false);
+    ThreadPool pool(2);
+    clearTrace();
+    enableTracing(true);
+    // La parte 0 espera a la 1, así que la 1 la tiene que correr el worker
+    atomic<bool> workerRan{false};
+    pool.run(2, [&](int id, int) {
+        if (id == 1) workerRan = true;
+        while (!workerRan) this_thread::yield();
+    });
+    enableTracing(false);
+
+    ASSERT_TRUE(writeTrace("trace_names_test.json"));
+    ifstream file("trace_names_test.json");
+    string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    EXPECT_NE(json.find("\"worker 1\""), string::npos);
+    filesystem::remove("trace_names_test.json");
+    clearTrace();
+}
+
+// Buffer pool tests
+TEST(BufferPoolTest, ScratchBuffersAreRecycled) {
+    uint8_t* first;
+    {
+        ScratchBuffer buffer(100000);
+        first = buffer.data();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0u);
+        buffer.resize(5000); // alcanza el mismo bloque
+        EXPECT_EQ(buffer.data(), first);
+    }
+    ScratchBuffer again(90000);
+    EXPECT_EQ(again.data(), first);
+    ScratchBuffer tiny(16); // un bloque mucho más grande no se usa para un pedido chico
+    EXPECT_NE(tiny.data(), first);
+}
+
+TEST(BufferPoolTest, EvictsOldestBlocksOverTheLimit) {
+    releaseBufferPool();
+    setBufferPoolLimit(1 << 20);
+    set<uint8_t*> newest;
+    {
+        // Tres bloques de 512 KiB libres a la vez no entran en 1 MiB: sale el que se devolvió primero
+        ScratchBuffer a(512 * 1024), b(512 * 1024), c(512 * 1024);
+        newest = { b.data(), c.data() };
+        a.reset();
+        b.reset();
+        c.reset();
+        EXPECT_EQ(bufferPoolStats().pooledBytes, 1u << 20);
+    }
+    ScratchBuffer x(512 * 1024), y(512 * 1024);
+    EXPECT_EQ(set<uint8_t*>({ x.data(), y.data() }), newest);
+    x.reset();
+    y.reset();
+
+    // Un bloque más grande que el límite no se guarda
+    { ScratchBuffer huge(4 << 20); }
+    EXPECT_LE(bufferPoolStats().pooledBytes, 1u << 20);
+
+    setBufferPoolLimit(0);
+    releaseBufferPool();
+}
+
+TEST(BufferPoolTest, PipelinesReachSteadyState) {
+    // Después de la primera imagen, las siguientes no reservan memoria nueva
+    registerFilters();
+    vector<FilterStep> steps = { {"boxblur", {"5"}}, {"unsharp", {"3", "150"}}, {"gaussian", {"2"}}, {"negative", {}} };
+    BmpImage original = makePatternImage(300, 200);
+    for (bool planar : {false, true}) {
+        BmpImage img = original;
+        planar ? applyPipelinePlanar(img, steps, 1) : applyPipelineFused(img, steps, 1);
+        BufferPoolStats before = bufferPoolStats();
+        for (int i = 0; i < 3; ++i) {
+            img = original;
+            planar ? applyPipelinePlanar(img, steps, 1) : applyPipelineFused(img, steps, 1);
+        }
+        BufferPoolStats after = bufferPoolStats();
+        EXPECT_EQ(after.allocations, before.allocations) << (planar ? "planos" : "intercalado");
+        EXPECT_GT(after.reuses, before.reuses);
+    }
+    releaseFilterBuffers();
+    releaseBufferPool();
+    EXPECT_EQ(bufferPoolStats().pooledBytes, 0u);
+}
+
+// Automatic thread count tests
+TEST(AutoThreadsTest, PicksCheapestCalibratedCount) {
+    registerFilters();
+    // Con 4 hilos el costo por pixel es la cuarta parte, pero repartir cuesta 100 ns más
+    {
+        ofstream file("calibration_test.txt");
+        file << "negative\t1 1 0 2 0.5 40 4 0.25 100\n";
+        file << "boxblur\t1 8 0 4 4 100\n";
+    }
+    setCalibrationFile("calibration_test.txt");
+    EXPECT_EQ(autoThreads({ "negative", {} }, 10, 5, 4), 1);
+    EXPECT_EQ(autoThreads({ "negative", {} }, 1000, 1000, 4), 4);
+    EXPECT_EQ(autoThreads({ "negative", {} }, 1000, 1000, 2), 2);
+    // boxblur sólo se midió con 1 y 4 hilos
+    EXPECT_EQ(autoThreads({ "boxblur", {"5"} }, 1000, 1000, 4), 4);
+    EXPECT_EQ(autoThreads({ "boxblur", {"5"} }, 1000, 1000, 1), 1);
+    EXPECT_EQ(stepThreads(3, { "negative", {} }, 1000, 1000), 3);
+
+    // Un filtro sin calibrar se mide una vez y queda guardado en el archivo
+    int threads = autoThreads({ "grayscale", {} }, 500, 500, 2);
+    EXPECT_GE(threads, 1);
+    EXPECT_LE(threads, 2);
+    ifstream file("calibration_test.txt");
+    string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    EXPECT_NE(contents.find("grayscale\t1 "), string::npos);
+
+    setCalibrationFile("");
+    filesystem::remove("calibration_test.txt");
+}
+
+TEST(AutoThreadsTest, ConcurrentCallersCalibrateOnce) {
+    registerFilters();
+    filesystem::remove("calibration_test.txt");
+    setCalibrationFile("calibration_test.txt");
+    // Varios trabajos piden a la vez un filtro sin calibrar: se mide una sola vez
+    vector<thread> callers;
+    for (int i = 0; i < 4; ++i) {
+        callers.emplace_back([] { autoThreads({ "threshold", {"4"} }, 500, 500, 2); });
+    }
+    for (auto& caller : callers) caller.join();
+    ifstream file("calibration_test.txt");
+    int lines = 0;
+    for (string line; getline(file, line);) lines += line.rfind("threshold\t", 0) == 0;
+    EXPECT_EQ(lines, 1);
+
+    setCalibrationFile("");
+    filesystem::remove("calibration_test.txt");
+}
+
+TEST(AutoThreadsTest, CalibratesAheadByFilterName) {
+    registerFilters();
+    filesystem::remove("calibration_test.txt");
+    setCalibrationFile("calibration_test.txt");
+    // Los tamaños no entran en la clave, y los pasos inválidos se saltean
+    calibrateSteps({ { "boxblur", {"5"} }, { "boxblur", {"9"} }, { "boxblur", {"0"} }, { "resize", {"4000", "3000"} } }, 2);
+    autoThreads({ "boxblur", {"31"} }, 500, 500, 2);
+    autoThreads({ "resize", {"20", "10"} }, 500, 500, 2);
+
+    ifstream file("calibration_test.txt");
+    vector<string> keys;
+    for (string line; getline(file, line);) {
+        keys.push_back(line.substr(0, line.find('\t')));
+        // resize se ajusta por pixel del resultado: con un tamaño fijo de salida daría 0 por pixel
+        if (keys.back() == "resize") {
+            istringstream values(line.substr(line.find('\t') + 1));
+            ThreadCost cost;
+            while (values >> cost.threads >> cost.perPixel >> cost.fixed) EXPECT_GT(cost.perPixel, 0);
+        }
+    }
+    EXPECT_EQ(keys, (vector<string>{ "boxblur", "resize" }));
+
+    setCalibrationFile("");
+    filesystem::remove("calibration_test.txt");
+}
+
+TEST(AutoThreadsTest, PipelinesMatchFixedThreads) {
+    registerFilters();
+    setCalibrationFile("");
+    BmpImage original = makePatternImage(120, 80);
+    vector<FilterStep> steps = {
+        {"negative", {}}, {"grayscale", {}}, {"boxblur", {"5"}}, {"scale", {"0.5"}}, {"unsharp", {"3", "150"}}
+    };
+    BmpImage expected = original;
+    applyPipeline(expected, steps, 1);
+    for (auto apply : { applyPipeline, applyPipelineFused, applyPipelinePlanar }) {
+        BmpImage actual = original;
+        apply(actual, steps, AUTO_THREADS);
+        ASSERT_EQ(actual.getWidth(), expected.getWidth());
+        for (int y = 0; y < expected.getHeight(); ++y) {
+            ASSERT_EQ(memcmp(actual.getRowData(y), expected.getRowData(y), expected.getWidth() * 3), 0) << "fila " << y;
+        }
+    }
+}
+
+// Thread pool tests
+TEST(ThreadPoolTest, CapsThreadCount) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    // Pedir más hilos de los que tiene el pool no debe crear hilos nuevos
+    atomic<int> calls = 0;
+    atomic<int> used = 0;
+    pool.run(1000, [&](int id, int n) {
+        used = n;
+        ++calls;
+    });
+    EXPECT_EQ(used, 4);
+    EXPECT_EQ(calls, 4);
+}
+
+TEST(ThreadPoolTest, ReusedAcrossCalls) {
+    ThreadPool pool(3);
+    vector<int> hits(3, 0);
+    for (int round = 0; round < 100; ++round) {
+        pool.run(3, [&](int id, int n) { hits[id]++; });
+    }
+    EXPECT_EQ(hits, vector<int>(3, 100));
+}
+
+TEST(ThreadPoolTest, ParallelForCoversRangeOnce) {
+    ThreadPool pool(4);
+    for (int grain : {0, 1, 3, 7, 1000}) {
+        vector<atomic<int>> hits(101);
+        pool.parallelFor(4, 0, 101, grain, [&](int from, int to) {
+            for (int i = from; i < to; ++i) hits[i]++;
+        });
+        for (int i = 0; i < 101; ++i) {
+            EXPECT_EQ(hits[i], 1) << "grain " << grain << ", indice " << i;
+        }
+    }
+}
+
+TEST(ThreadPoolTest, ParallelForBalancesUnevenWork) {
+    ThreadPool pool(4);
+    // Los 16 bloques de la primera banda son mucho más caros que el resto: con robo de trabajo,
+    // los hilos que terminan su banda barata se llevan parte de la cara
+    vector<atomic<int>> hits(64);
+    vector<thread::id> owners(64);
+    pool.parallelFor(4, 0, 64, 1, [&](int from, int to) {
+        if (from < 16) this_thread::sleep_for(chrono::milliseconds(2));
+        for (int i = from; i < to; ++i) {
+            hits[i]++;
+            owners[i] = this_thread::get_id();
+        }
+    });
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_EQ(hits[i], 1);
+    }
+    set<thread::id> expensiveOwners(owners.begin(), owners.begin() + 16);
+    EXPECT_GT(expensiveOwners.size(), 1u);
+}
+
+#if defined(__linux__)
+static int allowedCpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    return CPU_COUNT(&set);
+}
+
+TEST(ThreadPoolTest, PinnedWorkersRunOnOneCore) {
+    int before = allowedCpus();
+    {
+        ThreadPool pool(3, true);
+        EXPECT_TRUE(pool.isPinned());
+        vector<int> cpus(3, 0);
+        pool.run(3, [&](int id, int) { cpus[id] = allowedCpus(); });
+        // El hilo que llama (índice 0) no se fija
+        EXPECT_EQ(cpus, vector<int>({ before, 1, 1 }));
+
+        // Los hilos creados después del pool no heredan un único núcleo
+        int inherited = 0;
+        thread([&] { inherited = allowedCpus(); }).join();
+        EXPECT_EQ(inherited, before);
+    }
+    EXPECT_EQ(allowedCpus(), before);
+}
+#endif
+
+TEST(ThreadPoolTest, FirstTouchCoversEveryRow) {
+    initThreadPool(4, true);
+    vector<atomic<int>> hits(3000);
+    firstTouchRows(3000, 4096, [&](int from, int to) {
+        for (int i = from; i < to; ++i) hits[i]++;
+    });
+    for (int i = 0; i < 3000; ++i) {
+        ASSERT_EQ(hits[i], 1) << "fila " << i;
+    }
+
+    // Una imagen grande se crea en negro aunque la llenen varios hilos
+    BmpImage img;
+    img.create(1601, 1000);
+    for (int y = 0; y < img.getHeight(); y += 37) {
+        ASSERT_TRUE(all_of(img.getRowData(y), img.getRowData(y) + img.getRowStride(), [](uint8_t v) { return v == 0; }));
+    }
+    initThreadPool(thread::hardware_concurrency());
+}
+
+TEST(ThreadPoolTest, PropagatesExceptions) {
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.run(2, [](int id, int n) {
+        if (id == 1) throw runtime_error("falla");
+    }), runtime_error);
+}
+
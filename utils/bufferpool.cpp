@@ -0,0 +1,172 @@
+#include "bufferpool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Cantidad máxima de bloques libres que guarda el pool.
+ */
+static const size_t MAX_POOLED_BLOCKS = 32;
+
+/**
+ * @brief Límite automático de bytes libres: tantas veces el pedido más grande que se haya hecho (un
+ * pipeline usa unos pocos buffers del tamaño de la imagen), y nunca menos que el mínimo.
+ */
+static const size_t AUTO_LIMIT_FACTOR = 4;
+static const size_t AUTO_LIMIT_MINIMUM = 64 * 1024 * 1024;
+
+static const size_t BLOCK_GRANULARITY = 4096;
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+struct PooledBlock {
+    uint8_t* bytes;
+    size_t capacity;
+};
+
+struct PoolState {
+    mutex lock;
+    vector<PooledBlock> freeBlocks; ///< Del que se devolvió hace más tiempo al más reciente.
+    size_t pooledBytes = 0;
+    size_t largestRequest = 0;
+    size_t limit = 0;               ///< 0: automático (ver AUTO_LIMIT_FACTOR).
+    uint64_t allocations = 0;
+    uint64_t reuses = 0;
+};
+
+/**
+ * @brief Estado del pool. No se destruye nunca: los buffers estáticos o thread_local de otros
+ * archivos (las imágenes auxiliares de los filtros) pueden devolver sus bloques durante la
+ * destrucción de estáticos, después de que se destruirían las variables de este archivo.
+ */
+static PoolState& pool() {
+    static PoolState* state = new PoolState();
+    return *state;
+}
+
+static atomic<bool> hugePages{false};
+
+void enableHugePages(bool enabled) {
+    hugePages = enabled;
+}
+
+void setBufferPoolLimit(size_t bytes) {
+    PoolState& state = pool();
+    lock_guard<mutex> lock(state.lock);
+    state.limit = bytes;
+}
+
+uint8_t* acquireBuffer(size_t size, size_t& capacity) {
+    PoolState& state = pool();
+    {
+        lock_guard<mutex> lock(state.lock);
+        state.largestRequest = max(state.largestRequest, size);
+        // El bloque libre más chico que alcance, siempre que no desperdicie más de la mitad
+        auto best = state.freeBlocks.end();
+        for (auto it = state.freeBlocks.begin(); it != state.freeBlocks.end(); ++it) {
+            if (it->capacity >= size && it->capacity <= 2 * size + 16 * BLOCK_GRANULARITY &&
+                (best == state.freeBlocks.end() || it->capacity < best->capacity)) {
+                best = it;
+            }
+        }
+        if (best != state.freeBlocks.end()) {
+            uint8_t* bytes = best->bytes;
+            capacity = best->capacity;
+            state.pooledBytes -= best->capacity;
+            state.freeBlocks.erase(best);
+            ++state.reuses;
+            return bytes;
+        }
+        ++state.allocations;
+    }
+
+    bool huge = hugePages && size >= HUGE_PAGE_SIZE;
+    size_t alignment = huge ? HUGE_PAGE_SIZE : 64;
+    size_t granularity = huge ? HUGE_PAGE_SIZE : BLOCK_GRANULARITY;
+    capacity = (size + granularity - 1) / granularity * granularity;
+    uint8_t* bytes = static_cast<uint8_t*>(aligned_alloc(alignment, capacity));
+    if (!bytes) throw bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge) madvise(bytes, capacity, MADV_HUGEPAGE);
+#endif
+    return bytes;
+}
+
+void recycleBuffer(uint8_t* block, size_t capacity) {
+    if (!block) return;
+    PoolState& state = pool();
+    vector<uint8_t*> discarded;
+    {
+        lock_guard<mutex> lock(state.lock);
+        state.freeBlocks.push_back({ block, capacity });
+        state.pooledBytes += capacity;
+        // Si sobran bloques o bytes, vuelven al sistema los que llevan más tiempo sin usarse (un
+        // bloque más grande que el límite sale enseguida)
+        size_t limit = state.limit > 0 ? state.limit
+                                       : max(AUTO_LIMIT_MINIMUM, AUTO_LIMIT_FACTOR * state.largestRequest);
+        size_t evicted = 0;
+        while (evicted < state.freeBlocks.size() &&
+               (state.freeBlocks.size() - evicted > MAX_POOLED_BLOCKS || state.pooledBytes > limit)) {
+            discarded.push_back(state.freeBlocks[evicted].bytes);
+            state.pooledBytes -= state.freeBlocks[evicted].capacity;
+            ++evicted;
+        }
+        state.freeBlocks.erase(state.freeBlocks.begin(), state.freeBlocks.begin() + evicted);
+    }
+    for (uint8_t* bytes : discarded) free(bytes);
+}
+
+void releaseBufferPool() {
+    PoolState& state = pool();
+    vector<PooledBlock> blocks;
+    {
+        lock_guard<mutex> lock(state.lock);
+        blocks.swap(state.freeBlocks);
+        state.pooledBytes = 0;
+    }
+    for (const PooledBlock& block : blocks) free(block.bytes);
+}
+
+BufferPoolStats bufferPoolStats() {
+    PoolState& state = pool();
+    lock_guard<mutex> lock(state.lock);
+    return { state.allocations, state.reuses, state.pooledBytes };
+}
+
+ScratchBuffer::ScratchBuffer(ScratchBuffer&& other) noexcept {
+    *this = move(other);
+}
+
+ScratchBuffer& ScratchBuffer::operator=(ScratchBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        bytes = exchange(other.bytes, nullptr);
+        length = exchange(other.length, 0);
+        capacity = exchange(other.capacity, 0);
+    }
+    return *this;
+}
+
+void ScratchBuffer::resize(size_t size) {
+    if (size <= capacity) {
+        length = size;
+        return;
+    }
+    reset();
+    if (size > 0) bytes = acquireBuffer(size, capacity);
+    length = size;
+}
+
+void ScratchBuffer::reset() {
+    recycleBuffer(bytes, capacity);
+    bytes = nullptr;
+    length = 0;
+    capacity = 0;
+}
@@ -0,0 +1,103 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief Pide al pool un bloque de memoria de al menos size bytes, alineado a 64 bytes.
+ * @param size Cantidad de bytes pedida (mayor que cero).
+ * @param capacity Donde se guarda el tamaño real del bloque, que hay que pasarle a recycleBuffer.
+ * @return El bloque, sin inicializar.
+ * @throws bad_alloc Si no hay memoria.
+ * @details Si hay un bloque libre de tamaño parecido se reutiliza; si no, se reserva uno nuevo. Así
+ * los buffers grandes que los filtros piden y sueltan en cada paso (imágenes auxiliares, bloques,
+ * tablas) no vuelven al sistema entre pasos, y en régimen no hay reservas ni fallos de página
+ * nuevos. Se puede llamar desde cualquier hilo.
+ */
+uint8_t* acquireBuffer(size_t size, size_t& capacity);
+
+/**
+ * @brief Devuelve al pool un bloque obtenido con acquireBuffer.
+ * @details Si el pool queda con demasiados bloques libres o con más bytes libres que el límite (ver
+ * setBufferPoolLimit), vuelven al sistema los bloques que llevan más tiempo sin usarse.
+ */
+void recycleBuffer(uint8_t* block, size_t capacity);
+
+/**
+ * @brief Fija cuántos bytes pueden guardar los bloques libres del pool.
+ * @param bytes El límite, o 0 para el automático: cuatro veces el pedido más grande que se haya hecho
+ * (y al menos 64 MiB). Así un proceso largo (el servidor, un lote con imágenes de varios tamaños)
+ * no se queda con muchas copias del buffer de la imagen más grande que procesó.
+ */
+void setBufferPoolLimit(size_t bytes);
+
+/**
+ * @brief Devuelve al sistema todos los bloques libres del pool.
+ */
+void releaseBufferPool();
+
+/**
+ * @brief Usa páginas enormes transparentes (THP) para los bloques de 2 MiB o más que se reserven
+ * a partir de ahora.
+ * @details Los bloques se alinean a 2 MiB y se marcan con madvise(MADV_HUGEPAGE), lo que reduce los
+ * fallos de página y las entradas de TLB al recorrer imágenes grandes. En sistemas sin THP no hace nada.
+ */
+void enableHugePages(bool enabled);
+
+/**
+ * @brief Contadores del pool, para verificar que un pipeline no reserva memoria en régimen.
+ */
+struct BufferPoolStats {
+    uint64_t allocations; ///< Bloques reservados al sistema.
+    uint64_t reuses;      ///< Pedidos atendidos con un bloque libre.
+    size_t pooledBytes;   ///< Bytes en bloques libres.
+};
+
+BufferPoolStats bufferPoolStats();
+
+/**
+ * @brief Buffer auxiliar que sale del pool y vuelve a él al destruirse.
+ */
+class ScratchBuffer {
+public:
+    ScratchBuffer() = default;
+    explicit ScratchBuffer(size_t size) { resize(size); }
+    ScratchBuffer(ScratchBuffer&& other) noexcept;
+    ScratchBuffer& operator=(ScratchBuffer&& other) noexcept;
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+    ~ScratchBuffer() { reset(); }
+
+    /**
+     * @brief Deja el buffer con size bytes sin inicializar (el contenido anterior se pierde).
+     * @details Si el bloque actual alcanza, se reutiliza sin pasar por el pool.
+     */
+    void resize(size_t size);
+
+    /**
+     * @brief Devuelve el bloque al pool.
+     */
+    void reset();
+
+    uint8_t* data() { return bytes; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    /**
+     * @brief El buffer visto como un arreglo de T.
+     */
+    template <typename T>
+    T* as() { return reinterpret_cast<T*>(bytes); }
+    template <typename T>
+    const T* as() const { return reinterpret_cast<const T*>(bytes); }
+
+private:
+    uint8_t* bytes = nullptr;
+    size_t length = 0;
+    size_t capacity = 0;
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,71 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * @brief Cola con capacidad acotada para pasar trabajo entre etapas que corren en distintos hilos.
+ * @details push() espera mientras la cola está llena y pop() mientras está vacía, así una etapa
+ * rápida no acumula más de `capacity` elementos por delante de una lenta. Al cerrarla se despierta
+ * a todos los que esperan.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @param capacity Cantidad máxima de elementos en la cola (al menos 1).
+     */
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    /**
+     * @brief Agrega un elemento, esperando si la cola está llena.
+     * @return False si la cola se cerró (el elemento se descarta).
+     */
+    bool push(T item) {
+        unique_lock<mutex> lock(mtx);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Saca el próximo elemento, esperando si la cola está vacía.
+     * @return False si la cola se cerró y ya no quedan elementos.
+     */
+    bool pop(T& item) {
+        unique_lock<mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Cierra la cola: no se aceptan más elementos y pop() devuelve los que quedan.
+     */
+    void close() {
+        lock_guard<mutex> lock(mtx);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    deque<T> items;
+    mutex mtx;
+    condition_variable notFull;
+    condition_variable notEmpty;
+    bool closed = false;
+};
+
+#endif // QUEUE_H
@@ -0,0 +1,280 @@
+#include "threadpool.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Índice del hilo actual en su pool (0 para los hilos que no son del pool).
+ */
+static thread_local int poolWorkerIndex = 0;
+
+/**
+ * @brief Cuántas tareas del pool está ejecutando el hilo actual (más de una si se anidan).
+ */
+static thread_local int poolTaskDepth = 0;
+
+/**
+ * @brief Marca que el hilo actual está dentro de una tarea mientras dura el bloque.
+ */
+struct PoolTaskScope {
+    PoolTaskScope() { ++poolTaskDepth; }
+    ~PoolTaskScope() { --poolTaskDepth; }
+};
+
+/**
+ * @brief Núcleos en los que el hilo actual tiene permitido correr (vacío si no se puede saber).
+ */
+static vector<int> currentAffinity() {
+    vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+/**
+ * @brief Deja que el hilo actual corra sólo en los núcleos indicados.
+ */
+static void setAffinity(const vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+
+ThreadPool::ThreadPool(int size, bool pinned) : pinned(pinned) {
+    // El hilo que crea el pool no se fija: los hilos que cree después (lectores, escritores, trabajos
+    // del servidor) heredarían su afinidad y terminarían todos en el mismo núcleo
+    vector<int> cpus = pinned ? currentAffinity() : vector<int>();
+    for (int i = 1; i < size; ++i) {
+        workers.emplace_back([this, i, cpus] {
+            if (!cpus.empty()) setAffinity({ cpus[i % cpus.size()] });
+            poolWorkerIndex = i;
+            setTraceThreadName("worker " + to_string(i));
+            workerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool ThreadPool::runPending(unique_lock<mutex>& lock) {
+    if (queue.empty()) return false;
+    function<void()> job = move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    job();
+    lock.lock();
+    return true;
+}
+
+void ThreadPool::workerLoop() {
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping && queue.empty()) return;
+        runPending(lock);
+    }
+}
+
+void ThreadPool::run(int threads, const function<void(int, int)>& task) {
+    int n = clamp(threads, 1, size());
+    PoolTaskScope scope;
+    if (n == 1) {
+        TraceScope trace("trabajo", "tarea");
+        task(0, 1);
+        return;
+    }
+
+    int pending = n - 1;
+    exception_ptr error;
+    condition_variable done;
+
+    {
+        lock_guard<mutex> lock(mtx);
+        for (int i = 1; i < n; ++i) {
+            queue.push_back([&, i] {
+                PoolTaskScope scope;
+                exception_ptr failure;
+                try {
+                    TraceScope trace("trabajo", "tarea");
+                    task(i, n);
+                } catch (...) {
+                    failure = current_exception();
+                }
+                lock_guard<mutex> lock(mtx);
+                if (failure && !error) error = failure;
+                if (--pending == 0) done.notify_all();
+            });
+        }
+    }
+    cv.notify_all();
+
+    exception_ptr own;
+    try {
+        TraceScope trace("trabajo", "tarea");
+        task(0, n);
+    } catch (...) {
+        own = current_exception();
+    }
+
+    // Mientras quedan partes sin terminar, el hilo que llama ayuda con lo que haya en la cola
+    // (así las llamadas anidadas a run() no se quedan esperando hilos libres).
+    unique_lock<mutex> lock(mtx);
+    while (pending > 0) {
+        if (!runPending(lock)) done.wait(lock);
+    }
+    lock.unlock();
+
+    if (own) rethrow_exception(own);
+    if (error) rethrow_exception(error);
+}
+
+namespace {
+
+/**
+ * @brief Bloques pendientes de un hilo en parallelFor: [lo, hi).
+ * @details El dueño toma bloques desde lo; los ladrones se llevan la mitad final. Cada rango
+ * ocupa su propia línea de caché para que los hilos no se pisen al actualizarlos.
+ */
+struct alignas(64) WorkRange {
+    mutex mtx;
+    int lo = 0;
+    int hi = 0;
+};
+
+bool takeChunk(WorkRange* ranges, int n, int id, int& chunk) {
+    WorkRange& own = ranges[id];
+    {
+        lock_guard<mutex> lock(own.mtx);
+        if (own.lo < own.hi) {
+            chunk = own.lo++;
+            return true;
+        }
+    }
+
+    for (int k = 1; k < n; ++k) {
+        WorkRange& victim = ranges[(id + k) % n];
+        int stolenLo, stolenHi;
+        {
+            lock_guard<mutex> lock(victim.mtx);
+            int remaining = victim.hi - victim.lo;
+            if (remaining <= 0) continue;
+            stolenHi = victim.hi;
+            stolenLo = victim.hi - (remaining + 1) / 2;
+            victim.hi = stolenLo;
+        }
+        lock_guard<mutex> lock(own.mtx);
+        own.lo = stolenLo + 1;
+        own.hi = stolenHi;
+        chunk = stolenLo;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void ThreadPool::parallelFor(int threads, int begin, int end, int grain, const function<void(int, int)>& body) {
+    if (end <= begin) return;
+    int total = end - begin;
+    if (grain <= 0) {
+        grain = max(1, total / (max(1, threads) * 8));
+    }
+    int chunks = (total + grain - 1) / grain;
+    int n = clamp(threads, 1, min(size(), chunks));
+    if (n == 1) {
+        TraceScope trace("trabajo", "tarea");
+        body(begin, end);
+        return;
+    }
+
+    unique_ptr<WorkRange[]> ranges(new WorkRange[n]);
+    for (int i = 0; i < n; ++i) {
+        ranges[i].lo = static_cast<int>(static_cast<long long>(chunks) * i / n);
+        ranges[i].hi = static_cast<int>(static_cast<long long>(chunks) * (i + 1) / n);
+    }
+
+    // Cada hilo toma la banda de su índice en el pool si nadie la tomó; si no, la primera libre
+    unique_ptr<atomic<bool>[]> claimed(new atomic<bool>[n]);
+    for (int i = 0; i < n; ++i) claimed[i] = false;
+    run(n, [&](int, int) {
+        int id = poolWorkerIndex < n && !claimed[poolWorkerIndex].exchange(true) ? poolWorkerIndex : -1;
+        for (int band = 0; id < 0; ++band) {
+            if (!claimed[band].exchange(true)) id = band;
+        }
+        int chunk;
+        while (takeChunk(ranges.get(), n, id, chunk)) {
+            int from = begin + chunk * grain;
+            body(from, min(end, from + grain));
+        }
+    });
+}
+
+static unique_ptr<ThreadPool> globalPool;
+static mutex globalPoolMutex;
+
+static int hardwareThreads() {
+    return max(1, static_cast<int>(thread::hardware_concurrency()));
+}
+
+void initThreadPool(int threads, bool pinned) {
+    lock_guard<mutex> lock(globalPoolMutex);
+    globalPool.reset();
+    globalPool = make_unique<ThreadPool>(clamp(threads, 1, hardwareThreads()), pinned);
+}
+
+ThreadPool& threadPool() {
+    lock_guard<mutex> lock(globalPoolMutex);
+    if (!globalPool) {
+        globalPool = make_unique<ThreadPool>(hardwareThreads());
+    }
+    return *globalPool;
+}
+
+/**
+ * @brief Tamaño mínimo de un buffer para repartir su primera escritura entre los hilos.
+ */
+static const size_t FIRST_TOUCH_MIN_BYTES = 4 << 20;
+
+bool firstTouchSpread(size_t bytes) {
+    return bytes >= FIRST_TOUCH_MIN_BYTES && poolTaskDepth == 0 && threadPool().isPinned();
+}
+
+void firstTouchRows(int rows, size_t rowBytes, const function<void(int, int)>& touch) {
+    if (!firstTouchSpread(static_cast<size_t>(rows) * rowBytes)) {
+        touch(0, rows);
+        return;
+    }
+    ThreadPool& pool = threadPool();
+    // Con grano 1 la banda inicial del hilo i son las filas [rows * i / n, rows * (i + 1) / n), que
+    // es aproximadamente la misma que le toca en los filtros, sea cual sea su grano
+    pool.parallelFor(pool.size(), 0, rows, 1, touch);
+}
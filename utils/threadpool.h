@@ -0,0 +1,127 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Pool de hilos de larga duración compartido por todos los filtros.
+ * @details Los hilos se crean una sola vez y quedan esperando trabajo. Un pool de tamaño n
+ * tiene n - 1 hilos propios: el hilo que llama a run() también trabaja, así que como mucho
+ * hay n hilos ejecutando una misma tarea.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Crea el pool.
+     * @param size Cantidad máxima de hilos que pueden trabajar a la vez (incluyendo al que llama).
+     * @param pinned Si cada hilo del pool queda fijo en un núcleo (opcional): el hilo i en el núcleo i
+     * de los permitidos al proceso (dando la vuelta si hay más hilos que núcleos). El hilo que crea el
+     * pool no se fija, porque en Linux los hilos nuevos heredan la afinidad de quien los crea: los que
+     * se creen después del pool (el lector y el escritor de los lotes, los trabajos del servidor)
+     * pueden correr en cualquier núcleo.
+     * @note Fijar hilos sólo está soportado en Linux; en otros sistemas pinned no hace nada.
+     */
+    explicit ThreadPool(int size, bool pinned = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Obtiene el tamaño del pool.
+     * @return La cantidad máxima de hilos que pueden trabajar en una misma llamada a run().
+     */
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    /**
+     * @brief Indica si los hilos del pool están fijos en núcleos.
+     */
+    bool isPinned() const { return pinned; }
+
+    /**
+     * @brief Ejecuta una tarea en paralelo y espera a que termine.
+     * @param threads Cantidad de hilos del pool a utilizar. Se acota a [1, size()].
+     * @param task Función que recibe el índice del hilo (de 0 a n - 1) y la cantidad n de hilos usados.
+     * @note El índice 0 lo ejecuta el hilo que llama. Si alguna tarea lanza una excepción, se
+     * relanza acá una vez que terminaron todas.
+     */
+    void run(int threads, const function<void(int, int)>& task);
+
+    /**
+     * @brief Recorre el rango [begin, end) en paralelo, repartiendo bloques con robo de trabajo.
+     * @param threads Cantidad de hilos del pool a utilizar.
+     * @param begin Primer índice del rango (por ejemplo, la primera fila).
+     * @param end Índice siguiente al último.
+     * @param grain Cantidad de índices por bloque. Si es 0 o menor, se elige para tener unos 8 bloques por hilo.
+     * @param body Función que recibe un sub-rango [from, to) y lo procesa.
+     * @details Cada hilo empieza con una banda contigua de bloques y, cuando la termina, le roba la
+     * mitad de lo que le queda a otro hilo. Así los hilos que tienen bloques más baratos (o que el
+     * sistema operativo no interrumpe) ayudan a los demás. Si hay menos bloques que hilos, se usan
+     * menos hilos; un único bloque se procesa directamente en el hilo que llama. Cada hilo empieza
+     * por la banda de su mismo índice en el pool (si está libre), así que llamadas seguidas sobre el
+     * mismo rango reparten las bandas igual: cada hilo vuelve a las filas que ya tiene en caché (o,
+     * con hilos fijos, en la memoria de su nodo NUMA).
+     */
+    void parallelFor(int threads, int begin, int end, int grain, const function<void(int, int)>& body);
+
+private:
+    void workerLoop();
+    bool runPending(unique_lock<mutex>& lock);
+
+    vector<thread> workers;
+    bool pinned = false;
+    deque<function<void()>> queue;
+    mutex mtx;
+    condition_variable cv;
+    bool stopping = false;
+};
+
+/**
+ * @brief Crea (o vuelve a crear) el pool global de hilos.
+ * @param threads Cantidad de hilos pedida. Se acota a la cantidad de núcleos de la máquina.
+ * @param pinned Si los hilos quedan fijos en núcleos (opcional, ver ThreadPool). Además activa la
+ * primera escritura repartida de los buffers grandes (ver firstTouchRows).
+ * @note Debe llamarse una sola vez, antes de aplicar filtros (por ejemplo, después de registerFilters()).
+ */
+void initThreadPool(int threads, bool pinned = false);
+
+/**
+ * @brief Obtiene el pool global de hilos.
+ * @return El pool creado con initThreadPool. Si no se creó ninguno, se crea uno con un hilo por núcleo.
+ */
+ThreadPool& threadPool();
+
+/**
+ * @brief Inicializa un buffer por filas repartiendo las filas entre los hilos del pool global.
+ * @param rows Cantidad de filas.
+ * @param rowBytes Bytes por fila (para decidir si vale la pena repartir).
+ * @param touch Función que inicializa las filas [from, to), por ejemplo llenándolas de ceros.
+ * @details Linux ubica cada página en el nodo NUMA del hilo que la escribe por primera vez. Si el
+ * buffer lo inicializa un solo hilo, en una máquina con varios sockets los hilos del otro socket
+ * después leen y escriben todas sus filas a través de la interconexión. Repartiendo la
+ * inicialización con las mismas bandas que usa parallelFor, las páginas que se escriben por primera
+ * vez quedan en el nodo del hilo que las va a procesar. Sólo se reparte si el pool global tiene los
+ * hilos fijos, el buffer es grande y no se llama desde una tarea del pool; si no, se llama a
+ * touch(0, rows) directamente.
+ * @note Sólo sirve para memoria nueva. Los bloques que se reutilizan del pool de buffers (ver
+ * acquireBuffer) ya tienen sus páginas en el nodo donde se escribieron la primera vez, y repartir la
+ * inicialización no las mueve. En un pipeline largo o un lote de imágenes del mismo tamaño, que
+ * reutilizan los bloques, las páginas quedan donde las ubicó la primera imagen de cada tamaño.
+ */
+void firstTouchRows(int rows, size_t rowBytes, const function<void(int, int)>& touch);
+
+/**
+ * @brief Indica si firstTouchRows repartiría entre los hilos un buffer de bytes bytes.
+ * @note Sirve para no agregar una pasada de inicialización cuando no hace falta (por ejemplo, antes
+ * de leer un archivo directo al buffer).
+ */
+bool firstTouchSpread(size_t bytes);
+
+#endif // THREADPOOL_H
@@ -0,0 +1,152 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Un evento registrado: un intervalo de tiempo de un hilo.
+ */
+struct TraceEvent {
+    const char* category;
+    string name;
+    int thread;
+    long long start; // microsegundos desde traceOrigin
+    long long duration;
+};
+
+static atomic<bool> tracing{false};
+static const chrono::steady_clock::time_point traceOrigin = chrono::steady_clock::now();
+static mutex traceMutex;
+static vector<TraceEvent> traceEvents;
+static vector<string> threadNames;
+
+static thread_local int traceThread = -1;
+static thread_local int workDepth = 0;
+static thread_local string pendingName; // nombre pedido antes de que el hilo tuviera número
+
+/**
+ * @brief Obtiene el número del hilo que llama (se asigna la primera vez). Requiere traceMutex.
+ */
+static int currentThread() {
+    if (traceThread < 0) {
+        traceThread = static_cast<int>(threadNames.size());
+        threadNames.push_back(pendingName.empty() ? "hilo " + to_string(traceThread) : pendingName);
+    }
+    return traceThread;
+}
+
+void enableTracing(bool enabled) {
+    if (enabled) setTraceThreadName("principal");
+    tracing.store(enabled, memory_order_relaxed);
+}
+
+bool tracingEnabled() {
+    return tracing.load(memory_order_relaxed);
+}
+
+void setTraceThreadName(const string& name) {
+    pendingName = name;
+    if (!tracingEnabled() && traceThread < 0) return;
+    lock_guard<mutex> lock(traceMutex);
+    threadNames[currentThread()] = name;
+}
+
+TraceScope::TraceScope(const char* category, const string& name)
+    : active(tracingEnabled()), work(strcmp(category, "trabajo") == 0), category(category) {
+    // El trabajo anidado (por ejemplo, un parallelFor dentro de una tarea) ya está contado
+    if (work && workDepth++ > 0) active = false;
+    if (!active) return;
+    this->name = name;
+    start = chrono::steady_clock::now();
+}
+
+TraceScope::~TraceScope() {
+    if (work) --workDepth;
+    if (!active) return;
+    auto end = chrono::steady_clock::now();
+    long long from = chrono::duration_cast<chrono::microseconds>(start - traceOrigin).count();
+    long long to = chrono::duration_cast<chrono::microseconds>(end - traceOrigin).count();
+    lock_guard<mutex> lock(traceMutex);
+    traceEvents.push_back({ category, move(name), currentThread(), from, to - from });
+}
+
+/**
+ * @brief Escapa una cadena para escribirla entre comillas en JSON.
+ */
+static string jsonString(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool writeTrace(const string& filename) {
+    ofstream out(filename);
+    if (!out) return false;
+    lock_guard<mutex> lock(traceMutex);
+    out << "{\"traceEvents\": [\n";
+    for (size_t t = 0; t < threadNames.size(); ++t) {
+        out << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+            << ", \"args\": {\"name\": \"" << jsonString(threadNames[t]) << "\"}},\n";
+    }
+    for (size_t i = 0; i < traceEvents.size(); ++i) {
+        const TraceEvent& e = traceEvents[i];
+        out << "  {\"name\": \"" << jsonString(e.name) << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+            << e.thread << ", \"ts\": " << e.start << ", \"dur\": " << e.duration << "}"
+            << (i + 1 < traceEvents.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+    return static_cast<bool>(out);
+}
+
+void printTraceSummary(ostream& out) {
+    lock_guard<mutex> lock(traceMutex);
+    if (traceEvents.empty()) return;
+
+    // Etapas y filtros, en el orden en que aparecieron por primera vez
+    vector<string> order;
+    map<string, pair<int, long long>> stages; // nombre -> (veces, microsegundos)
+    vector<long long> busy(threadNames.size(), 0);
+    long long first = traceEvents.front().start, last = first;
+    for (const TraceEvent& e : traceEvents) {
+        first = min(first, e.start);
+        last = max(last, e.start + e.duration);
+        // Un hilo está ocupado mientras ejecuta tareas del pool o una etapa (lectura, escritura)
+        bool work = strcmp(e.category, "trabajo") == 0;
+        if (work || strcmp(e.category, "etapa") == 0) busy[e.thread] += e.duration;
+        if (work) continue;
+        auto& stage = stages[e.name];
+        if (stage.first++ == 0) order.push_back(e.name);
+        stage.second += e.duration;
+    }
+
+    out << fixed << setprecision(2);
+    out << left << setw(32) << "Etapa" << right << setw(8) << "Veces" << setw(12) << "Total ms" << setw(14) << "Promedio ms" << "\n";
+    for (const string& name : order) {
+        const auto& stage = stages[name];
+        out << left << setw(32) << name << right << setw(8) << stage.first << setw(12) << stage.second / 1e3
+            << setw(14) << stage.second / 1e3 / stage.first << "\n";
+    }
+
+    // El tiempo ocupado de cada hilo se compara con la duración total de la traza
+    double span = max(1LL, last - first);
+    out << "\n" << left << setw(32) << "Hilo" << right << setw(14) << "Ocupado ms" << setw(12) << "Ocupado %" << setw(12) << "Ocioso %" << "\n";
+    for (size_t t = 0; t < threadNames.size(); ++t) {
+        double share = 100.0 * busy[t] / span;
+        out << left << setw(32) << threadNames[t] << right << setw(14) << busy[t] / 1e3 << setw(12) << share
+            << setw(12) << 100.0 - share << "\n";
+    }
+    out << defaultfloat;
+}
+
+void clearTrace() {
+    lock_guard<mutex> lock(traceMutex);
+    traceEvents.clear();
+}
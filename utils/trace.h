@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Activa o desactiva el registro de eventos de tiempo.
+ * @details Desactivado (lo normal), TraceScope no hace nada más que leer una bandera. Al activarlo,
+ * el hilo que llama queda registrado como "principal".
+ */
+void enableTracing(bool enabled);
+
+/**
+ * @brief Indica si se están registrando eventos.
+ */
+bool tracingEnabled();
+
+/**
+ * @brief Le pone nombre al hilo que llama, para la traza y el resumen.
+ * @details Con la traza apagada solo se guarda el nombre en el hilo; se registra (tomando el mutex)
+ * recién cuando el hilo registra su primer evento.
+ */
+void setTraceThreadName(const string& name);
+
+/**
+ * @brief Mide el tiempo entre su construcción y su destrucción, y lo registra como un evento.
+ * @details Las categorías que se usan son "etapa" (lectura, escritura), "filtro" (cada paso del
+ * pipeline) y "trabajo" (el tiempo que cada hilo del pool pasa ejecutando tareas). Los eventos de
+ * "trabajo" anidados dentro de otro "trabajo" del mismo hilo no se registran, para no contar dos
+ * veces el tiempo ocupado.
+ */
+class TraceScope {
+public:
+    TraceScope(const char* category, const string& name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    bool active;
+    bool work;
+    const char* category;
+    string name;
+    chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Guarda los eventos registrados en formato Chrome trace-event (JSON), para abrir con
+ * chrome://tracing o Perfetto.
+ * @return True si se pudo escribir el archivo, false en caso contrario.
+ */
+bool writeTrace(const string& filename);
+
+/**
+ * @brief Imprime un resumen de los eventos: tiempo total por etapa y filtro, y cuánto estuvo
+ * ocupado cada hilo (ejecutando tareas del pool o etapas) respecto de la duración de la traza.
+ */
+void printTraceSummary(ostream& out);
+
+/**
+ * @brief Descarta los eventos registrados.
+ */
+void clearTrace();
+
+#endif // TRACE_H
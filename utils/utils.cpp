@@ -8,27 +8,46 @@
 
 using namespace std;
 
+FilterStep parseFilterStep(const string& arg) {
+    FilterStep step;
+
+    // split on ':' para parámetros
+    size_t colon = arg.find(':');
+    if (colon != string::npos) {
+        step.name = arg.substr(0, colon);
+        string params = arg.substr(colon + 1);
+        stringstream ss(params);
+        string token;
+        while (getline(ss, token, ',')) {
+            step.parameters.push_back(token);
+        }
+    } else {
+        step.name = arg;
+    }
+    return step;
+}
+
 vector<FilterStep> parsePipeline(int argc, char* argv[]) {
     vector<FilterStep> steps;
     for (int i = 4; i < argc; ++i) {
         string arg = argv[i];
-        FilterStep step;
+        if (arg.rfind("--", 0) == 0) continue;
+        steps.push_back(parseFilterStep(arg));
+    }
+    return steps;
+}
 
-        // split on ':' para parámetros
-        size_t colon = arg.find(':');
-        if (colon != string::npos) {
-            step.name = arg.substr(0, colon);
-            string params = arg.substr(colon + 1);
-            stringstream ss(params);
-            string token;
-            while (getline(ss, token, ',')) {
-                step.parameters.push_back(token);
-            }
+map<string, string> parseOptions(int argc, char* argv[]) {
+    map<string, string> options;
+    for (int i = 4; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) continue;
+        size_t equals = arg.find('=');
+        if (equals != string::npos) {
+            options[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
         } else {
-            step.name = arg;
+            options[arg.substr(2)] = "";
         }
-
-        steps.push_back(step);
     }
-    return steps;
+    return options;
 }
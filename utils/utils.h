@@ -13,6 +13,24 @@ struct FilterStep {
     vector<string> parameters;
 };
 
+/**
+ * @brief Interpreta un paso del pipeline con el formato filtro:p1,p2,... (o sólo filtro).
+ */
+FilterStep parseFilterStep(const string& arg);
+
+/**
+ * @brief Obtiene los pasos del pipeline de los argumentos del programa.
+ * @details Toma los argumentos a partir del cuarto (después de entrada, salida y threads), con el
+ * formato filtro:p1,p2,... Los argumentos que empiezan con "--" son opciones y se ignoran.
+ */
 vector<FilterStep> parsePipeline(int argc, char* argv[]);
 
+/**
+ * @brief Obtiene las opciones de los argumentos del programa.
+ * @details Las opciones van después de entrada, salida y threads, mezcladas con los filtros, con el
+ * formato --nombre=valor (o --nombre, que queda con valor vacío).
+ * @return Un mapa de nombre de opción (sin "--") a su valor.
+ */
+map<string, string> parseOptions(int argc, char* argv[]);
+
 #endif // UTILS_H
\ No newline at end of file